@@ -0,0 +1,92 @@
+// Code generation scaling over worker threads:
+//   csc_bench_codegen [function count] [statements per function]
+// Generates a synthetic program, parses it once and lowers it with 1, 2, 4, ...
+// threads up to twice the hardware concurrency. Every thread count has to
+// produce the same module.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include "Compiler/CallGraph.h"
+#include "Compiler/CodeGenerator.h"
+#include "Compiler/Lexer.h"
+#include "Compiler/Parser.h"
+#include "Compiler/SemanticAnalyzer.h"
+
+static std::string MakeProgram(size_t functionCount, size_t statementCount) {
+	std::string source;
+	for (size_t i = 0; i < functionCount; i++) {
+		source += "int F" + std::to_string(i) + "(int a, char s) {\n";
+		for (size_t j = 0; j < statementCount; j++) {
+			std::string name = "v" + std::to_string(j);
+			source += "    int " + name + " = a;\n";
+			source += "    { char t = \"text" + std::to_string(j % 16) + "\"; }\n";
+			if (i + 1 < functionCount)
+				source += "    F" + std::to_string(i + 1) + "(" + name + ", s);\n";
+		}
+		source += "    return a;\n}\n";
+	}
+	source += "int Main() {\n    return F0(1, \"s\");\n}\n";
+	return source;
+}
+
+int main(int argc, char** argv) {
+	size_t functionCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+	size_t statementCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+
+	Lexer lexer(MakeProgram(functionCount, statementCount));
+	Parser parser(lexer);
+	if (parser.Parse().Type != ResultType::Success) {
+		std::fprintf(stderr, "generated program failed to parse\n");
+		return 1;
+	}
+	CallGraph callGraph(parser.GetProgram());
+
+	// Locals come from the analyzer, that part is not timed
+	const auto& functions = parser.GetProgram().Functions;
+	SemanticAnalyzer analyzer(parser.GetProgram(), lexer.GetInput());
+	std::vector<FunctionSemantics> semantics(functions.size());
+	for (size_t i = 0; i < functions.size(); i++) {
+		if (callGraph.IsReachable(i))
+			semantics[i] = analyzer.Analyze(*functions[i]);
+	}
+
+	unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+	std::printf("%zu functions, %zu bytes of source, %u hardware threads\n", functionCount,
+		lexer.GetInput().size(), hardware);
+
+	std::vector<uint8_t> reference;
+	double baseline = 0;
+	for (unsigned threads = 1; threads <= hardware * 2; threads *= 2) {
+		CodeGenerator generator(threads);
+		double best = 0;
+		for (int run = 0; run < 3; run++) {
+			BytecodeModule module;
+			auto start = std::chrono::steady_clock::now();
+			CompilerResult result = generator.Generate(parser.GetProgram(), callGraph, semantics, module);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (result.Type != ResultType::Success) {
+				std::fprintf(stderr, "code generation failed\n");
+				return 1;
+			}
+
+			std::vector<uint8_t> serialized = module.Serialize();
+			if (reference.empty())
+				reference = std::move(serialized);
+			else if (serialized != reference) {
+				std::fprintf(stderr, "output differs with %u threads\n", threads);
+				return 1;
+			}
+			if (run == 0 || milliseconds < best)
+				best = milliseconds;
+		}
+
+		if (threads == 1)
+			baseline = best;
+		std::printf("%3u threads: %8.2f ms, speedup %.2fx\n", threads, best, baseline / best);
+	}
+	return 0;
+}
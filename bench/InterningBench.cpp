@@ -0,0 +1,78 @@
+// String interning under contention:
+//   csc_bench_interning [strings per thread] [distinct strings]
+// Runs 1, 2, 4, ... 64 threads that all intern from the same pool of strings,
+// first through the sharded StringInterner, then through an unordered_map
+// behind a single mutex. Most lookups hit strings that are already there, like
+// literals and names repeated across a program. Both have to agree on the
+// number of distinct strings.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Threading/StringInterner.h"
+
+class LockedInterner {
+public:
+	uint32_t Intern(const std::string& string) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Ids.emplace(string, (uint32_t)m_Ids.size()).first->second;
+	}
+
+	size_t GetSize() const { return m_Ids.size(); }
+private:
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, uint32_t> m_Ids;
+};
+
+template<typename Body>
+static double RunThreads(unsigned threadCount, const Body& body) {
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < threadCount; i++)
+		threads.emplace_back(body, i);
+	for (std::thread& thread : threads)
+		thread.join();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	size_t perThread = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	size_t distinct = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000;
+
+	std::vector<std::string> pool;
+	for (size_t i = 0; i < distinct; i++)
+		pool.push_back("identifier_" + std::to_string(i * 7919));
+
+	std::printf("%zu interns per thread, %zu distinct strings, %u hardware threads\n", perThread, distinct,
+		std::thread::hardware_concurrency());
+	std::printf("threads   sharded ms   mutex ms   speedup\n");
+
+	for (unsigned threadCount = 1; threadCount <= 64; threadCount *= 2) {
+		// Every thread walks the pool from a different start, so they collide on
+		// the same strings without moving in lockstep
+		StringInterner sharded(threadCount);
+		double shardedTime = RunThreads(threadCount, [&](unsigned thread) {
+			for (size_t i = 0; i < perThread; i++)
+				sharded.Intern(pool[(i + thread * 131) % distinct]);
+		});
+
+		LockedInterner locked;
+		double lockedTime = RunThreads(threadCount, [&](unsigned thread) {
+			for (size_t i = 0; i < perThread; i++)
+				locked.Intern(pool[(i + thread * 131) % distinct]);
+		});
+
+		if (sharded.GetSize() != locked.GetSize()) {
+			std::fprintf(stderr, "%u threads: %zu strings interned, expected %zu\n", threadCount, sharded.GetSize(),
+				locked.GetSize());
+			return 1;
+		}
+		std::printf("%7u %12.2f %10.2f %8.2fx\n", threadCount, shardedTime, lockedTime, lockedTime / shardedTime);
+	}
+	return 0;
+}
@@ -0,0 +1,74 @@
+// Lexer throughput and line table cost on ASCII source:
+//   csc_bench_lex [megabytes]
+// Token size is fixed by a static_assert in Lexer.h, it is printed here next to
+// the throughput so both can be compared across changes.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include "Compiler/Lexer.h"
+#include "ErrorHandling/LineTable.h"
+
+static std::string MakeSource(size_t bytes) {
+	std::string source;
+	for (size_t i = 0; source.size() < bytes; i++) {
+		source += "int Function" + std::to_string(i) + "(int count, char name) {\n";
+		source += "    int total = Add(count, 42);\n";
+		source += "    char label = \"function label\";\n";
+		source += "    { int nested = total; }\n";
+		source += "    return total;\n}\n\n";
+	}
+	return source;
+}
+
+template<typename Body>
+static double BestOf(int runs, const Body& body) {
+	double best = 0;
+	for (int run = 0; run < runs; run++) {
+		auto start = std::chrono::steady_clock::now();
+		body();
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (run == 0 || milliseconds < best)
+			best = milliseconds;
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+	std::string source = MakeSource(megabytes << 20);
+	double size = (double)source.size() / (1 << 20);
+	std::printf("sizeof(Token) = %zu (std::string %zu + type + offset)\n", sizeof(Token), sizeof(std::string));
+
+	size_t tokens = 0;
+	double lex = BestOf(3, [&] {
+		Lexer lexer(source);
+		tokens = 0;
+		while (lexer.Consume().Type != TokenType::EndOfFile)
+			tokens++;
+	});
+	std::printf("lex: %.1f MB in %.1f ms, %.0f MB/s, %.1f M tokens/s\n", size, lex, size / lex * 1000,
+		tokens / lex / 1000);
+
+	// The first Resolve builds the table, later ones only search it
+	std::mt19937 random(1);
+	std::vector<uint32_t> offsets(1000000);
+	for (uint32_t& offset : offsets)
+		offset = random() % (uint32_t)source.size();
+
+	double build = BestOf(3, [&] {
+		LineTable lines(source);
+		lines.Resolve(0);
+	});
+	LineTable lines(source);
+	uint64_t sum = 0;
+	double resolve = BestOf(3, [&] {
+		for (uint32_t offset : offsets)
+			sum += lines.Resolve(offset).Line;
+	});
+	std::printf("line table: built in %.1f ms (%.0f MB/s), %.0f ns per lookup (checksum %llu)\n", build,
+		size / build * 1000, resolve * 1e6 / offsets.size(), (unsigned long long)sum);
+	return 0;
+}
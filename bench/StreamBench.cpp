@@ -0,0 +1,143 @@
+// Peak memory of batch and streaming compiles:
+//   csc_bench_stream [megabytes] [csc binary]
+// Writes a generated program of the given size (2048 MB by default) to a
+// temporary file and compiles it with `csc` and `csc --stream`, each in a child
+// process with its output discarded. The peak resident set of every child is
+// taken from wait4. Batch mode keeps the whole AST and lowers it, streaming
+// keeps only the source and the function being printed. Both hold the source,
+// so streaming can't go below its size. Batch mode needs about 20 times the
+// source size, on smaller machines its row shows it being killed. POSIX only.
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef CSC_BINARY
+	#define CSC_BINARY "csc"
+#endif
+
+static std::string MakeFunction(size_t index) {
+	std::string name = "F" + std::to_string(index);
+	std::string source = "int " + name + "(int a, char s) {\n";
+	source += "    int total = a;\n";
+	source += "    char label = \"label " + std::to_string(index % 64) + "\";\n";
+	source += "    { int nested = total; }\n";
+	// Every function calls the previous one, so all of them are reachable and
+	// batch mode has to lower everything
+	if (index > 0)
+		source += "    return F" + std::to_string(index - 1) + "(total, s);\n}\n";
+	else
+		source += "    return total;\n}\n";
+	return source;
+}
+
+// Returns the number of functions written, 0 on failure
+static size_t WriteProgram(const std::string& path, size_t bytes) {
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return 0;
+
+	size_t written = 0;
+	size_t count = 0;
+	std::string chunk;
+	while (written < bytes) {
+		chunk.clear();
+		while (chunk.size() < (1 << 20))
+			chunk += MakeFunction(count++);
+		written += chunk.size();
+		if (written >= bytes)
+			chunk += "int Main() {\n    return F" + std::to_string(count - 1) + "(1, \"s\");\n}\n";
+		if (std::fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size()) {
+			std::fclose(file);
+			return 0;
+		}
+	}
+	return std::fclose(file) == 0 ? count : 0;
+}
+
+struct RunResult {
+	bool Ok;
+	double Seconds;
+	long PeakKilobytes;
+	std::string Status;
+};
+
+static RunResult Run(const std::vector<std::string>& arguments) {
+	std::vector<char*> argv;
+	for (const std::string& argument : arguments)
+		argv.push_back(const_cast<char*>(argument.c_str()));
+	argv.push_back(nullptr);
+
+	auto start = std::chrono::steady_clock::now();
+	pid_t pid = ::fork();
+	if (pid < 0)
+		return {false, 0, 0, "fork failed"};
+	if (pid == 0) {
+		int null = ::open("/dev/null", O_WRONLY);
+		::dup2(null, STDOUT_FILENO);
+		::execv(argv[0], argv.data());
+		std::perror(argv[0]);
+		::_exit(127);
+	}
+
+	int status = 0;
+	rusage usage = {};
+	while (::wait4(pid, &status, 0, &usage) < 0) {
+		if (errno != EINTR)
+			return {false, 0, 0, "wait4 failed"};
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef __APPLE__
+	long peak = usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+	long peak = usage.ru_maxrss;
+#endif
+	if (WIFSIGNALED(status))
+		return {false, seconds, peak, "killed by signal " + std::to_string(WTERMSIG(status))};
+	if (WEXITSTATUS(status) != 0)
+		return {false, seconds, peak, "exited with " + std::to_string(WEXITSTATUS(status))};
+	return {true, seconds, peak, "ok"};
+}
+
+int main(int argc, char** argv) {
+	size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2048;
+	std::string csc = argc > 2 ? argv[2] : CSC_BINARY;
+	std::string path = "/tmp/csc_bench_stream_" + std::to_string(::getpid()) + ".csl";
+
+	size_t functionCount = WriteProgram(path, megabytes << 20);
+	if (functionCount == 0) {
+		std::fprintf(stderr, "failed to write %s\n", path.c_str());
+		std::remove(path.c_str());
+		return 1;
+	}
+	std::printf("%zu MB of source, %zu functions\n", megabytes, functionCount);
+	std::printf("mode       seconds   peak RSS MB   peak / source\n");
+
+	bool ok = true;
+	const char* modes[] = {"batch", "stream"};
+	for (const char* mode : modes) {
+		std::vector<std::string> arguments = {csc};
+		if (std::string(mode) == "stream")
+			arguments.push_back("--stream");
+		arguments.push_back(path);
+
+		RunResult result = Run(arguments);
+		std::printf("%-8s %9.2f %13.1f %15.2f   %s\n", mode, result.Seconds, result.PeakKilobytes / 1024.0,
+			result.PeakKilobytes / 1024.0 / (double)megabytes, result.Status.c_str());
+		ok = ok && result.Ok;
+	}
+
+	std::string stem = path.substr(0, path.size() - 4);
+	std::remove(path.c_str());
+	std::remove((stem + ".csb").c_str());
+	std::remove((stem + ".csi").c_str());
+	return ok ? 0 : 1;
+}
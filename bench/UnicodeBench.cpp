@@ -0,0 +1,75 @@
+// UTF-8 validation and lexer throughput on ASCII and mixed input:
+//   csc_bench_unicode [megabytes]
+// The mixed input has Unicode identifiers and string literals with two, three
+// and four byte sequences, so it leaves the ASCII fast paths regularly.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "Compiler/Lexer.h"
+#include "Compiler/Unicode.h"
+
+static std::string MakeSource(size_t bytes, bool mixed) {
+	std::string source;
+	for (size_t i = 0; source.size() < bytes; i++) {
+		std::string suffix = std::to_string(i);
+		if (mixed) {
+			source += "int Größe" + suffix + "(int wert, char 名前) {\n";
+			source += "    int 变量 = Größe" + suffix + "(wert, 名前);\n";
+			source += "    char text = \"ünïcödé ✓ 😀\";\n";
+			source += "    return 变量;\n}\n\n";
+		} else {
+			source += "int Size" + suffix + "(int value, char name) {\n";
+			source += "    int variable = Size" + suffix + "(value, name);\n";
+			source += "    char text = \"plain ascii text\";\n";
+			source += "    return variable;\n}\n\n";
+		}
+	}
+	return source;
+}
+
+template<typename Body>
+static double BestOf(int runs, const Body& body) {
+	double best = 0;
+	for (int run = 0; run < runs; run++) {
+		auto start = std::chrono::steady_clock::now();
+		body();
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (run == 0 || milliseconds < best)
+			best = milliseconds;
+	}
+	return best;
+}
+
+static void Run(const char* name, const std::string& source) {
+	double size = (double)source.size() / (1 << 20);
+
+	size_t invalid = 0;
+	double validate = BestOf(5, [&] { invalid = Unicode::FindInvalidUtf8(source.data(), source.size()); });
+	if (invalid != source.size())
+		std::printf("%s: unexpected invalid UTF-8 at %zu\n", name, invalid);
+
+	size_t tokens = 0;
+	size_t invalidTokens = 0;
+	double lex = BestOf(3, [&] {
+		Lexer lexer(source);
+		tokens = 0;
+		invalidTokens = 0;
+		for (Token token = lexer.Consume(); token.Type != TokenType::EndOfFile; token = lexer.Consume()) {
+			tokens++;
+			if (token.Type == TokenType::Invalid)
+				invalidTokens++;
+		}
+	});
+
+	std::printf("%-6s %.1f MB: validate %.0f MB/s, lex %.0f MB/s (%.1f M tokens/s, %zu invalid)\n", name, size,
+		size / validate * 1000, size / lex * 1000, tokens / lex / 1000, invalidTokens);
+}
+
+int main(int argc, char** argv) {
+	size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+	Run("ascii", MakeSource(megabytes << 20, false));
+	Run("mixed", MakeSource(megabytes << 20, true));
+	return 0;
+}
@@ -0,0 +1,107 @@
+// Feeds the front end inputs that stress one construct each and doubles their
+// size, failing if the time grows faster than n^1.5 on any of them:
+//   csc_complexity_check [base count]
+// Linear code doubles in time per doubling, quadratic code quadruples, the
+// threshold sits in between to leave room for timing noise.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Compiler/CodeGenerator.h"
+#include "Driver/CompileUnit.h"
+
+struct Family {
+	const char* Name;
+	std::function<std::string(size_t)> Make;
+};
+
+static std::string Repeat(const std::string& text, size_t count) {
+	std::string result;
+	result.reserve(text.size() * count);
+	for (size_t i = 0; i < count; i++)
+		result += text;
+	return result;
+}
+
+static const Family s_Families[] = {
+	{"nested blocks", [](size_t n) { return "int Main() {" + Repeat("{", n) + Repeat("}", n) + " return 0; }\n"; }},
+	{"unclosed blocks", [](size_t n) { return "int Main() {" + Repeat("{ int x;", n); }},
+	{"nested calls", [](size_t n) { return "int F(int x) { return x; }\nint Main() { return " + Repeat("F(", n) + "1"
+		+ Repeat(")", n) + "; }\n"; }},
+	{"unbalanced conditions", [](size_t n) { return "int Main() {" + Repeat("if (( while (", n) + "}\n"; }},
+	{"call chain", [](size_t n) {
+		std::string source = "int F0() { return 0; }\n";
+		for (size_t i = 1; i < n; i++)
+			source += "int F" + std::to_string(i) + "() { return F" + std::to_string(i - 1) + "(); }\n";
+		return source;
+	}},
+	{"many locals", [](size_t n) {
+		std::string source = "int Main() {\n int v0 = 0;\n";
+		for (size_t i = 1; i < n; i++)
+			source += " int v" + std::to_string(i) + " = v0;\n";
+		return source + " return v0;\n}\n";
+	}},
+	{"many callees", [](size_t n) {
+		std::string source;
+		for (size_t i = 0; i < n; i++)
+			source += "int F" + std::to_string(i) + "() { return 0; }\n";
+		source += "int Main() {\n";
+		for (size_t i = 0; i < n; i++)
+			source += " F" + std::to_string(i) + "();\n";
+		return source + " return 0;\n}\n";
+	}},
+	{"many strings", [](size_t n) {
+		std::string source = "char Main() {\n";
+		for (size_t i = 0; i < n; i++)
+			source += " char s" + std::to_string(i) + " = \"string " + std::to_string(i % 64) + "\";\n";
+		return source + " return \"done\";\n}\n";
+	}},
+	{"long identifier", [](size_t n) { return "int " + Repeat("abcdefgh", n) + "() { return 0; }\n"; }},
+	{"long literal", [](size_t n) { return "char Main() { return \"" + Repeat("abcdefgh", n) + "\"; }\n"; }},
+	{"syntax errors", [](size_t n) { return Repeat("int F( { ) } ; return return\n", n); }},
+};
+
+static double Measure(const std::string& source) {
+	double best = 0;
+	for (int run = 0; run < 3; run++) {
+		auto start = std::chrono::steady_clock::now();
+		CompileUnit unit("check.csl", source);
+		unit.Analyze({});
+		if (unit.GetResult().Type == ResultType::Success) {
+			CodeGenerator generator(1);
+			BytecodeModule module;
+			generator.Generate(unit.GetProgram(), unit.GetCallGraph(), unit.GetSemantics(), module);
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (run == 0 || milliseconds < best)
+			best = milliseconds;
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	size_t base = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+	const int doublings = 3;
+	bool ok = true;
+
+	for (const Family& family : s_Families) {
+		std::printf("%-22s", family.Name);
+		std::vector<double> times;
+		for (int i = 0; i <= doublings; i++) {
+			times.push_back(Measure(family.Make(base << i)));
+			std::printf(" %9.2f ms", times.back());
+		}
+
+		// The smallest size mostly measures setup, the growth is taken from the
+		// larger ones. Too fast to time reliably means nothing grew out of hand.
+		double exponent = times.back() < 10 ? 1 : std::log2(times.back() / times[1]) / (doublings - 1);
+		bool linear = exponent <= 1.5;
+		std::printf("   n^%.2f %s\n", exponent, linear ? "ok" : "SUPERLINEAR");
+		ok = ok && linear;
+	}
+	return ok ? 0 : 1;
+}
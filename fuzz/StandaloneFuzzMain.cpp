@@ -0,0 +1,79 @@
+// Replays inputs through the fuzz target where libFuzzer isn't available:
+//   csc_parser_fuzzer <file or directory>...
+// Directories are replayed file by file, so the seed corpus and any crash
+// found elsewhere can be checked with a plain GCC or MSVC build.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "IO/File.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <sys/stat.h>
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#ifdef _WIN32
+static void Collect(const std::string& path, std::vector<std::string>& files) {
+	DWORD attributes = ::GetFileAttributesA(path.c_str());
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+		return;
+	if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		files.push_back(path);
+		return;
+	}
+
+	WIN32_FIND_DATAA entry;
+	HANDLE find = ::FindFirstFileA((path + "\\*").c_str(), &entry);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+	do {
+		std::string name = entry.cFileName;
+		if (name != "." && name != "..")
+			Collect(path + "\\" + name, files);
+	} while (::FindNextFileA(find, &entry));
+	::FindClose(find);
+}
+#else
+static void Collect(const std::string& path, std::vector<std::string>& files) {
+	struct stat info;
+	if (::stat(path.c_str(), &info) != 0)
+		return;
+	if (!S_ISDIR(info.st_mode)) {
+		files.push_back(path);
+		return;
+	}
+
+	DIR* dir = ::opendir(path.c_str());
+	if (dir == nullptr)
+		return;
+	while (dirent* entry = ::readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name != "." && name != "..")
+			Collect(path + "/" + name, files);
+	}
+	::closedir(dir);
+}
+#endif
+
+int main(int argc, char** argv) {
+	std::vector<std::string> files;
+	// libFuzzer flags like -runs=0 are accepted so both builds run the same way
+	for (int i = 1; i < argc; i++)
+		if (argv[i][0] != '-')
+			Collect(argv[i], files);
+
+	for (const std::string& file : files) {
+		std::vector<unsigned char> input = File::ReadBinaryFile(file);
+		LLVMFuzzerTestOneInput(input.data(), input.size());
+	}
+	std::printf("Replayed %zu input(s)\n", files.size());
+	return 0;
+}
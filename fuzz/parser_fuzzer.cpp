@@ -0,0 +1,37 @@
+// libFuzzer target for the front end: lexing, parsing, semantic analysis and
+// code generation of arbitrary bytes. Built with -DCSC_FUZZ=ON, run as
+//   csc_parser_fuzzer fuzz/corpus
+// Without Clang the same target is linked against StandaloneFuzzMain.cpp and
+// only replays the files it is given.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fcntl.h>
+#include "Compiler/CodeGenerator.h"
+#include "Driver/CompileUnit.h"
+
+#ifdef _WIN32
+	#include <io.h>
+	#define OpenNull() _open("NUL", _O_WRONLY)
+#else
+	#define OpenNull() ::open("/dev/null", O_WRONLY)
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	// Diagnostics are written so line resolution is covered, but nobody reads them
+	static int s_Null = OpenNull();
+
+	CompileUnit unit("fuzz.csl", std::string(reinterpret_cast<const char*>(data), size));
+	unit.Analyze({});
+	if (unit.GetResult().Type == ResultType::Success) {
+		CodeGenerator generator(1);
+		BytecodeModule module;
+		generator.Generate(unit.GetProgram(), unit.GetCallGraph(), unit.GetSemantics(), module);
+		module.Serialize();
+	}
+
+	OutputBuffer output(s_Null);
+	unit.WriteDiagnostics(output);
+	return 0;
+}
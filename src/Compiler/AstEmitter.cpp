@@ -0,0 +1,306 @@
+#include "AstEmitter.h"
+
+AstEmitter::AstEmitter(OutputBuffer& output, AstFormat format) : m_Output(output), m_Format(format) {
+
+}
+
+void AstEmitter::Emit(const ProgramNode& program) {
+	BeginProgram(program.Functions.size());
+	Visit(program);
+	EndProgram();
+}
+
+void AstEmitter::BeginProgram(size_t functionCount) {
+	if (m_Format == AstFormat::Json) {
+		m_Output.Write("{\"functions\":[", 14);
+	} else if (m_Format == AstFormat::Binary) {
+		m_Output.Write("CSA\x01", 4);
+		BeginBinary(AstTag::Program, 0);
+		WriteVarInt(functionCount);
+	}
+	m_FirstFunction = true;
+}
+
+void AstEmitter::EndProgram() {
+	if (m_Format == AstFormat::Json)
+		m_Output.Write("]}\n", 3);
+}
+
+void AstEmitter::Emit(const FunctionNode& function) {
+	m_FirstFunction = true;
+	Visit(function);
+
+	if (m_Format == AstFormat::Json)
+		m_Output.Put('\n');
+}
+
+bool AstEmitter::ParseFormat(const std::string& name, AstFormat& format) {
+	if (name == "text")
+		format = AstFormat::Text;
+	else if (name == "json")
+		format = AstFormat::Json;
+	else if (name == "binary")
+		format = AstFormat::Binary;
+	else
+		return false;
+	return true;
+}
+
+const char* AstEmitter::FormatToString(AstFormat format) {
+	switch (format) {
+		case AstFormat::Text: return "text";
+		case AstFormat::Json: return "json";
+		case AstFormat::Binary: return "binary";
+		default: return "unknown";
+	}
+}
+
+bool AstEmitter::EnterFunction(const FunctionNode& function) {
+	if (m_Format == AstFormat::Text) {
+		BeginText("Function: ");
+		m_Output.Write(function.ReturnType);
+		m_Output.Put(' ');
+		m_Output.Write(function.Name);
+		m_Output.Put('(');
+		for (size_t i = 0; i < function.Parameters.size(); i++) {
+			if (i != 0)
+				m_Output.Write(", ", 2);
+			m_Output.Write(function.ParameterTypes[i]);
+			m_Output.Put(' ');
+			m_Output.Write(function.Parameters[i]);
+		}
+		m_Output.Put(')');
+	} else if (m_Format == AstFormat::Json) {
+		if (!m_FirstFunction)
+			m_Output.Put(',');
+		m_FirstFunction = false;
+		m_Output.Write("{\"kind\":\"Function\",\"offset\":");
+		m_Output.WriteUInt(function.Offset);
+		WriteJsonField("name", function.Name);
+		WriteJsonField("returnType", function.ReturnType);
+		m_Output.Write(",\"parameters\":[", 15);
+		for (size_t i = 0; i < function.Parameters.size(); i++) {
+			m_Output.Write(i == 0 ? "{" : ",{", i == 0 ? 1 : 2);
+			m_Output.Write("\"type\":", 7);
+			WriteJsonString(function.ParameterTypes[i]);
+			WriteJsonField("name", function.Parameters[i]);
+			m_Output.Put('}');
+		}
+		m_Output.Put(']');
+	} else {
+		BeginBinary(AstTag::Function, function.Offset);
+		WriteBinaryString(function.Name);
+		WriteBinaryString(function.ReturnType);
+		WriteVarInt(function.Parameters.size());
+		for (size_t i = 0; i < function.Parameters.size(); i++) {
+			WriteBinaryString(function.ParameterTypes[i]);
+			WriteBinaryString(function.Parameters[i]);
+		}
+	}
+	return EndNode();
+}
+
+bool AstEmitter::EnterBlock(const BlockExpression& /*block*/, uint32_t offset) {
+	return EmitNode("Block", AstTag::Block, offset);
+}
+
+bool AstEmitter::EnterDeclaration(const DeclarationExpression& dec, uint32_t offset) {
+	return EmitNode("Declaration", AstTag::Declaration, offset, &dec.Type, &dec.Identifier);
+}
+
+bool AstEmitter::EnterInitialization(const InitializationExpression& dec, uint32_t offset) {
+	return EmitNode("Initialization", AstTag::Initialization, offset, &dec.Type, &dec.Identifier);
+}
+
+bool AstEmitter::EnterAssignment(const AssignmentExpression& assignment, uint32_t offset) {
+	return EmitNode("Assignment", AstTag::Assignment, offset, nullptr, &assignment.Identifier);
+}
+
+bool AstEmitter::EnterCall(const FunctionCallExpression& call, uint32_t offset) {
+	if (m_Format == AstFormat::Text) {
+		BeginText("Call: ");
+		m_Output.Write(call.Name);
+	} else if (m_Format == AstFormat::Json) {
+		BeginJson("Call", offset);
+		WriteJsonField("name", call.Name);
+	} else {
+		BeginBinary(AstTag::Call, offset);
+		WriteBinaryString(call.Name);
+	}
+	return EndNode();
+}
+
+bool AstEmitter::EnterValue(const ValueExpression& value, uint32_t offset) {
+	switch (value.Type) {
+		case ValueExpressionType::StringLiteral:
+			if (m_Format == AstFormat::Text) {
+				BeginText("String: ");
+				m_Output.Write(value.StringLiteral);
+			} else if (m_Format == AstFormat::Json) {
+				BeginJson("String", offset);
+				WriteJsonField("value", value.StringLiteral);
+			} else {
+				BeginBinary(AstTag::StringLiteral, offset);
+				WriteBinaryString(value.StringLiteral);
+			}
+			break;
+		case ValueExpressionType::Variable:
+		case ValueExpressionType::FunctionCall:
+			if (m_Format == AstFormat::Text) {
+				BeginText("Variable: ");
+				m_Output.Write(value.VariableName);
+			} else if (m_Format == AstFormat::Json) {
+				BeginJson("Variable", offset);
+				WriteJsonField("name", value.VariableName);
+			} else {
+				BeginBinary(AstTag::Variable, offset);
+				WriteBinaryString(value.VariableName);
+			}
+			break;
+		default:
+			if (m_Format == AstFormat::Text) {
+				BeginText("Int: ");
+				m_Output.WriteInt(value.ValueLiteral);
+			} else if (m_Format == AstFormat::Json) {
+				BeginJson("Int", offset);
+				m_Output.Write(",\"value\":", 9);
+				m_Output.WriteInt(value.ValueLiteral);
+			} else {
+				BeginBinary(AstTag::IntLiteral, offset);
+				int64_t v = value.ValueLiteral;
+				WriteVarInt(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+			}
+			break;
+	}
+	return EndNode();
+}
+
+bool AstEmitter::EnterUnaryOperation(const UnaryOperationExpression& /*operation*/, uint32_t offset) {
+	return EmitNode("UnaryOperation", AstTag::UnaryOperation, offset);
+}
+
+bool AstEmitter::EnterBinaryOperation(const BinaryOperationExpression& /*operation*/, uint32_t offset) {
+	return EmitNode("BinaryOperation", AstTag::BinaryOperation, offset);
+}
+
+bool AstEmitter::EnterReturn(const ReturnExpression& /*returnExpression*/, uint32_t offset) {
+	return EmitNode("Return", AstTag::Return, offset);
+}
+
+bool AstEmitter::EnterWhile(const WhileExpression& /*whileExpression*/, uint32_t offset) {
+	return EmitNode("While", AstTag::While, offset);
+}
+
+bool AstEmitter::EnterIf(const IfExpression& /*ifExpression*/, uint32_t offset) {
+	return EmitNode("If", AstTag::If, offset);
+}
+
+bool AstEmitter::EnterElse(const ElseExpression& /*elseExpression*/, uint32_t offset) {
+	return EmitNode("Else", AstTag::Else, offset);
+}
+
+void AstEmitter::LeaveNode() {
+	if (m_Format == AstFormat::Json)
+		m_Output.Write("]}", 2);
+}
+
+bool AstEmitter::EmitNode(const char* label, AstTag tag, uint32_t offset, const std::string* type, const std::string* name) {
+	if (m_Format == AstFormat::Text) {
+		BeginText(label);
+		if (type != nullptr || name != nullptr)
+			m_Output.Write(": ", 2);
+		if (type != nullptr) {
+			m_Output.Write(*type);
+			m_Output.Put(' ');
+		}
+		if (name != nullptr)
+			m_Output.Write(*name);
+	} else if (m_Format == AstFormat::Json) {
+		BeginJson(label, offset);
+		if (type != nullptr)
+			WriteJsonField("type", *type);
+		if (name != nullptr)
+			WriteJsonField("name", *name);
+	} else {
+		BeginBinary(tag, offset);
+		if (type != nullptr)
+			WriteBinaryString(*type);
+		if (name != nullptr)
+			WriteBinaryString(*name);
+	}
+	return EndNode();
+}
+
+bool AstEmitter::EndNode() {
+	if (m_Format == AstFormat::Text)
+		m_Output.Put('\n');
+	else if (m_Format == AstFormat::Json)
+		m_Output.Write(",\"children\":[", 13);
+	else
+		WriteVarInt(GetChildCount());
+	return true;
+}
+
+void AstEmitter::BeginText(const char* label) {
+	m_Output.WriteIndent(GetDepth() * 2);
+	m_Output.Write(label);
+}
+
+void AstEmitter::BeginJson(const char* kind, uint32_t offset) {
+	if (!IsFirstChild())
+		m_Output.Put(',');
+	m_Output.Write("{\"kind\":\"", 9);
+	m_Output.Write(kind);
+	m_Output.Write("\",\"offset\":", 11);
+	m_Output.WriteUInt(offset);
+}
+
+void AstEmitter::BeginBinary(AstTag tag, uint32_t offset) {
+	m_Output.Put((char)tag);
+	WriteVarInt(offset);
+}
+
+void AstEmitter::WriteJsonString(const std::string& text) {
+	static const char hex[] = "0123456789abcdef";
+
+	m_Output.Put('"');
+	for (char c : text) {
+		switch (c) {
+			case '"': m_Output.Write("\\\"", 2); break;
+			case '\\': m_Output.Write("\\\\", 2); break;
+			case '\n': m_Output.Write("\\n", 2); break;
+			case '\r': m_Output.Write("\\r", 2); break;
+			case '\t': m_Output.Write("\\t", 2); break;
+			default:
+				if ((unsigned char)c < 0x20) {
+					m_Output.Write("\\u00", 4);
+					m_Output.Put(hex[(unsigned char)c >> 4]);
+					m_Output.Put(hex[(unsigned char)c & 0xF]);
+				} else {
+					m_Output.Put(c);
+				}
+				break;
+		}
+	}
+	m_Output.Put('"');
+}
+
+void AstEmitter::WriteJsonField(const char* name, const std::string& value) {
+	m_Output.Write(",\"", 2);
+	m_Output.Write(name, std::char_traits<char>::length(name));
+	m_Output.Write("\":", 2);
+	WriteJsonString(value);
+}
+
+void AstEmitter::WriteVarInt(uint64_t value) {
+	while (value >= 0x80) {
+		m_Output.Put((char)(value | 0x80));
+		value >>= 7;
+	}
+	m_Output.Put((char)value);
+}
+
+void AstEmitter::WriteBinaryString(const std::string& text) {
+	WriteVarInt(text.size());
+	m_Output.Write(text);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include "Parser.h"
+#include "AstVisitor.h"
+#include "IO/OutputBuffer.h"
+
+enum class AstFormat {
+	Text,
+	Json,
+	Binary
+};
+
+// Node tags of the binary format. A dump starts with "CSA" and a version byte,
+// followed by the nodes in pre-order: tag (u8), offset (varint), tag specific
+// fields (strings are a varint length followed by the bytes, integers are
+// zigzag varints) and finally the number of children (varint).
+enum class AstTag : uint8_t {
+	Program = 1,		// -
+	Function,			// name, return type, parameter count, (type, name) per parameter
+	Block,				// -
+	Declaration,		// type, name
+	Initialization,		// type, name
+	Assignment,			// name
+	Call,				// name
+	IntLiteral,			// value
+	StringLiteral,		// value
+	Variable,			// name
+	UnaryOperation,		// -
+	BinaryOperation,	// -
+	Return,				// -
+	While,				// -
+	If,					// -
+	Else				// -
+};
+
+// Writes the AST into an OutputBuffer. Traversal goes through AstVisitor, so
+// the native stack depth does not grow with the nesting of blocks.
+class AstEmitter : public AstVisitor<AstEmitter> {
+public:
+	AstEmitter(OutputBuffer& output, AstFormat format);
+
+	void Emit(const ProgramNode& program);
+	void Emit(const FunctionNode& function);
+
+	// For programs that are not in memory as a whole: BeginProgram, Visit for
+	// every function, EndProgram. The binary format needs the function count up
+	// front, text ignores it.
+	void BeginProgram(size_t functionCount);
+	void EndProgram();
+
+	static bool ParseFormat(const std::string& name, AstFormat& format);
+	static const char* FormatToString(AstFormat format);
+private:
+	friend class AstVisitor<AstEmitter>;
+
+	bool EnterFunction(const FunctionNode& function);
+	bool EnterBlock(const BlockExpression& block, uint32_t offset);
+	bool EnterDeclaration(const DeclarationExpression& dec, uint32_t offset);
+	bool EnterInitialization(const InitializationExpression& dec, uint32_t offset);
+	bool EnterAssignment(const AssignmentExpression& assignment, uint32_t offset);
+	bool EnterCall(const FunctionCallExpression& call, uint32_t offset);
+	bool EnterValue(const ValueExpression& value, uint32_t offset);
+	bool EnterUnaryOperation(const UnaryOperationExpression& operation, uint32_t offset);
+	bool EnterBinaryOperation(const BinaryOperationExpression& operation, uint32_t offset);
+	bool EnterReturn(const ReturnExpression& returnExpression, uint32_t offset);
+	bool EnterWhile(const WhileExpression& whileExpression, uint32_t offset);
+	bool EnterIf(const IfExpression& ifExpression, uint32_t offset);
+	bool EnterElse(const ElseExpression& elseExpression, uint32_t offset);
+	void LeaveNode();
+
+	bool EmitNode(const char* label, AstTag tag, uint32_t offset, const std::string* type = nullptr,
+		const std::string* name = nullptr);
+	bool EndNode();
+
+	void BeginText(const char* label);
+	void BeginJson(const char* kind, uint32_t offset);
+	void BeginBinary(AstTag tag, uint32_t offset);
+	void WriteJsonString(const std::string& text);
+	void WriteJsonField(const char* name, const std::string& value);
+	void WriteVarInt(uint64_t value);
+	void WriteBinaryString(const std::string& text);
+
+	OutputBuffer& m_Output;
+	AstFormat m_Format;
+	bool m_FirstFunction = true;
+};
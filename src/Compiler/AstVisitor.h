@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Parser.h"
+#include "Threading/ThreadPool.h"
+
+// Compile time dispatched AST traversal. A pass derives from AstVisitor<Pass>
+// and defines the hooks it cares about, for example:
+//
+//   class CallCounter : public AstVisitor<CallCounter> {
+//   public:
+//       bool EnterCall(const FunctionCallExpression& call, uint32_t offset) { Count++; return true; }
+//       size_t Count = 0;
+//   };
+//
+// Enter hooks run in pre-order and return false to skip the children of the
+// node, Leave hooks run in post-order. Hooks a pass does not define fall back to
+// EnterNode/LeaveNode, which do nothing by default. Calls are resolved through
+// the derived type, so there is no virtual dispatch and the compiler can inline
+// the handlers. Nodes are kept on an explicit stack, so nesting depth does not
+// grow the native stack.
+//
+// A call used as a value is visited as a Call node, expressions wrapping a value
+// are visited as the Value node itself.
+template<typename Derived>
+class AstVisitor {
+public:
+	void Visit(const ProgramNode& program) {
+		for (const FunctionNode* function : program.Functions)
+			Visit(*function);
+	}
+
+	void Visit(const FunctionNode& function) {
+		Run({NodeKind::Function, false, true, function.Offset, 0, &function});
+	}
+
+	// Valid inside a hook: nesting depth of the current node (functions are 0),
+	// number of children that will be visited and whether it is the first child
+	uint32_t GetDepth() const { return m_Current.Depth; }
+	size_t GetChildCount() const { return m_ChildCount; }
+	bool IsFirstChild() const { return m_Current.First; }
+
+	bool EnterNode(uint32_t /*offset*/) { return true; }
+	void LeaveNode() {}
+
+	bool EnterFunction(const FunctionNode& node) { return Self().EnterNode(node.Offset); }
+	void LeaveFunction(const FunctionNode& /*node*/) { Self().LeaveNode(); }
+	bool EnterBlock(const BlockExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveBlock(const BlockExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterDeclaration(const DeclarationExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveDeclaration(const DeclarationExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterInitialization(const InitializationExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveInitialization(const InitializationExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterAssignment(const AssignmentExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveAssignment(const AssignmentExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterCall(const FunctionCallExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveCall(const FunctionCallExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterValue(const ValueExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveValue(const ValueExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterUnaryOperation(const UnaryOperationExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveUnaryOperation(const UnaryOperationExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterBinaryOperation(const BinaryOperationExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveBinaryOperation(const BinaryOperationExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterReturn(const ReturnExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveReturn(const ReturnExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterWhile(const WhileExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveWhile(const WhileExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterIf(const IfExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveIf(const IfExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+	bool EnterElse(const ElseExpression& /*node*/, uint32_t offset) { return Self().EnterNode(offset); }
+	void LeaveElse(const ElseExpression& /*node*/, uint32_t /*offset*/) { Self().LeaveNode(); }
+private:
+	enum class NodeKind : uint8_t {
+		Function,
+		Block,
+		Declaration,
+		Initialization,
+		Assignment,
+		Call,
+		Value,
+		UnaryOperation,
+		BinaryOperation,
+		Return,
+		While,
+		If,
+		Else
+	};
+
+	struct Frame {
+		NodeKind Kind;
+		bool Leave;
+		bool First;
+		uint32_t Offset;
+		uint32_t Depth;
+		const void* Node;
+	};
+
+	Derived& Self() { return *static_cast<Derived*>(this); }
+
+	void Run(const Frame& root) {
+		m_Stack.clear();
+		m_Stack.push_back(root);
+		while (!m_Stack.empty()) {
+			m_Current = m_Stack.back();
+			m_Stack.pop_back();
+
+			if (m_Current.Leave) {
+				Leave(m_Current);
+				continue;
+			}
+
+			// Children go on the stack first so the hook can see how many there are,
+			// the leave frame goes below them
+			size_t leaveIndex = m_Stack.size();
+			m_Stack.push_back(m_Current);
+			m_Stack.back().Leave = true;
+			PushChildren(m_Current);
+			m_ChildCount = m_Stack.size() - leaveIndex - 1;
+
+			if (!Enter(m_Current))
+				m_Stack.resize(leaveIndex + 1);
+		}
+	}
+
+	void PushChildren(const Frame& frame) {
+		size_t first = m_Stack.size();
+		uint32_t depth = frame.Depth + 1;
+
+		switch (frame.Kind) {
+			case NodeKind::Function: {
+				auto& function = *static_cast<const FunctionNode*>(frame.Node);
+				m_Stack.push_back({NodeKind::Block, false, false, function.Offset, depth, &function.Block});
+				break;
+			}
+			case NodeKind::Block:
+				PushBlock(*static_cast<const BlockExpression*>(frame.Node), depth);
+				break;
+			case NodeKind::Initialization:
+				PushExpression(static_cast<const InitializationExpression*>(frame.Node)->ValueExpression, depth);
+				break;
+			case NodeKind::Assignment:
+				PushExpression(static_cast<const AssignmentExpression*>(frame.Node)->ValueExpression, depth);
+				break;
+			case NodeKind::Call:
+				for (const ValueExpression* argument : static_cast<const FunctionCallExpression*>(frame.Node)->Arguments)
+					PushValue(argument, depth);
+				break;
+			case NodeKind::Return:
+				PushValue(static_cast<const ReturnExpression*>(frame.Node)->Value, depth);
+				break;
+			case NodeKind::While: {
+				auto& node = *static_cast<const WhileExpression*>(frame.Node);
+				PushExpression(node.ConditionExpression, depth);
+				PushExpression(node.BodyExpression, depth);
+				break;
+			}
+			case NodeKind::If: {
+				auto& node = *static_cast<const IfExpression*>(frame.Node);
+				PushExpression(node.ConditionExpression, depth);
+				PushExpression(node.BodyExpression, depth);
+				break;
+			}
+			case NodeKind::Else:
+				PushExpression(static_cast<const ElseExpression*>(frame.Node)->BodyExpression, depth);
+				break;
+			default:
+				break;
+		}
+
+		// Pushed in source order, reverse so the first child is visited first
+		if (m_Stack.size() > first) {
+			m_Stack[first].First = true;
+			std::reverse(m_Stack.begin() + first, m_Stack.end());
+		}
+	}
+
+	void PushBlock(const BlockExpression& block, uint32_t depth) {
+		for (const Expression& expression : block.Expressions)
+			PushExpression(&expression, depth);
+	}
+
+	void PushExpression(const Expression* expression, uint32_t depth) {
+		if (expression == nullptr)
+			return;
+
+		NodeKind kind;
+		switch (expression->Type) {
+			case ExpressionType::Value:
+				PushValue(static_cast<const ValueExpression*>(expression->Data), depth);
+				return;
+			case ExpressionType::Declaration: kind = NodeKind::Declaration; break;
+			case ExpressionType::Assignment: kind = NodeKind::Assignment; break;
+			case ExpressionType::DeclarationWithAssignment: kind = NodeKind::Initialization; break;
+			case ExpressionType::Block: kind = NodeKind::Block; break;
+			case ExpressionType::FunctionCall: kind = NodeKind::Call; break;
+			case ExpressionType::UnaryOperation: kind = NodeKind::UnaryOperation; break;
+			case ExpressionType::BinaryOperation: kind = NodeKind::BinaryOperation; break;
+			case ExpressionType::Return: kind = NodeKind::Return; break;
+			case ExpressionType::While: kind = NodeKind::While; break;
+			case ExpressionType::If: kind = NodeKind::If; break;
+			case ExpressionType::Else: kind = NodeKind::Else; break;
+			default: return;
+		}
+		m_Stack.push_back({kind, false, false, expression->Offset, depth, expression->Data});
+	}
+
+	void PushValue(const ValueExpression* value, uint32_t depth) {
+		if (value == nullptr)
+			return;
+		if (value->Type == ValueExpressionType::FunctionCall && value->FunctionCall != nullptr)
+			m_Stack.push_back({NodeKind::Call, false, false, value->Offset, depth, value->FunctionCall});
+		else
+			m_Stack.push_back({NodeKind::Value, false, false, value->Offset, depth, value});
+	}
+
+	bool Enter(const Frame& frame) {
+		switch (frame.Kind) {
+			case NodeKind::Function: return Self().EnterFunction(*static_cast<const FunctionNode*>(frame.Node));
+			case NodeKind::Block: return Self().EnterBlock(*static_cast<const BlockExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Declaration: return Self().EnterDeclaration(*static_cast<const DeclarationExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Initialization: return Self().EnterInitialization(*static_cast<const InitializationExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Assignment: return Self().EnterAssignment(*static_cast<const AssignmentExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Call: return Self().EnterCall(*static_cast<const FunctionCallExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Value: return Self().EnterValue(*static_cast<const ValueExpression*>(frame.Node), frame.Offset);
+			case NodeKind::UnaryOperation: return Self().EnterUnaryOperation(*static_cast<const UnaryOperationExpression*>(frame.Node), frame.Offset);
+			case NodeKind::BinaryOperation: return Self().EnterBinaryOperation(*static_cast<const BinaryOperationExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Return: return Self().EnterReturn(*static_cast<const ReturnExpression*>(frame.Node), frame.Offset);
+			case NodeKind::While: return Self().EnterWhile(*static_cast<const WhileExpression*>(frame.Node), frame.Offset);
+			case NodeKind::If: return Self().EnterIf(*static_cast<const IfExpression*>(frame.Node), frame.Offset);
+			case NodeKind::Else: return Self().EnterElse(*static_cast<const ElseExpression*>(frame.Node), frame.Offset);
+		}
+		return false;
+	}
+
+	void Leave(const Frame& frame) {
+		switch (frame.Kind) {
+			case NodeKind::Function: Self().LeaveFunction(*static_cast<const FunctionNode*>(frame.Node)); break;
+			case NodeKind::Block: Self().LeaveBlock(*static_cast<const BlockExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Declaration: Self().LeaveDeclaration(*static_cast<const DeclarationExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Initialization: Self().LeaveInitialization(*static_cast<const InitializationExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Assignment: Self().LeaveAssignment(*static_cast<const AssignmentExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Call: Self().LeaveCall(*static_cast<const FunctionCallExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Value: Self().LeaveValue(*static_cast<const ValueExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::UnaryOperation: Self().LeaveUnaryOperation(*static_cast<const UnaryOperationExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::BinaryOperation: Self().LeaveBinaryOperation(*static_cast<const BinaryOperationExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Return: Self().LeaveReturn(*static_cast<const ReturnExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::While: Self().LeaveWhile(*static_cast<const WhileExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::If: Self().LeaveIf(*static_cast<const IfExpression*>(frame.Node), frame.Offset); break;
+			case NodeKind::Else: Self().LeaveElse(*static_cast<const ElseExpression*>(frame.Node), frame.Offset); break;
+		}
+	}
+
+	std::vector<Frame> m_Stack;
+	Frame m_Current = {};
+	size_t m_ChildCount = 0;
+};
+
+// Runs body(index, function) for every function of the list, usually with a
+// visitor of its own per call. Functions share nothing after parsing, so the
+// calls run on the pool without synchronization. Without a pool, or with a
+// single function, they run in order on the calling thread.
+template<typename Function, typename Body>
+void ForEachFunction(const std::vector<Function*>& functions, ThreadPool* pool, const Body& body) {
+	if (pool == nullptr || functions.size() <= 1) {
+		for (size_t i = 0; i < functions.size(); i++)
+			body(i, *functions[i]);
+		return;
+	}
+	pool->ParallelFor(functions.size(), [&](size_t i) { body(i, *functions[i]); });
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <unordered_map>
+#include "CallGraph.h"
+#include "AstVisitor.h"
+
+class CallCollector : public AstVisitor<CallCollector> {
+public:
+	CallCollector(const std::unordered_map<std::string, uint32_t>& functionIndices, std::vector<uint32_t>& callees)
+		: m_FunctionIndices(functionIndices), m_Callees(callees) {}
+
+	bool EnterCall(const FunctionCallExpression& call, uint32_t /*offset*/) {
+		auto it = m_FunctionIndices.find(call.Name);
+		if (it != m_FunctionIndices.end())
+			m_Callees.push_back(it->second);
+		return true;
+	}
+private:
+	const std::unordered_map<std::string, uint32_t>& m_FunctionIndices;
+	std::vector<uint32_t>& m_Callees;
+};
+
+CallGraph::CallGraph(const ProgramNode& program, const std::string& entry) {
+	const auto& functions = program.Functions;
+
+	std::unordered_map<std::string, uint32_t> functionIndices;
+	functionIndices.reserve(functions.size());
+	for (size_t i = 0; i < functions.size(); i++)
+		functionIndices.emplace(functions[i]->Name, (uint32_t)i);
+
+	m_Callees.resize(functions.size());
+	for (size_t i = 0; i < functions.size(); i++) {
+		std::vector<uint32_t>& callees = m_Callees[i];
+		CallCollector collector(functionIndices, callees);
+		collector.Visit(*functions[i]);
+		std::sort(callees.begin(), callees.end());
+		callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+	}
+
+	FindComponents();
+
+	auto it = functionIndices.find(entry);
+	if (it != functionIndices.end()) {
+		MarkReachable(it->second);
+	} else {
+		m_Reachable.assign(functions.size(), true);
+		m_ReachableCount = functions.size();
+	}
+}
+
+bool CallGraph::IsRecursive(size_t function) const {
+	if (m_ComponentSizes[m_Components[function]] > 1)
+		return true;
+	const std::vector<uint32_t>& callees = m_Callees[function];
+	return std::binary_search(callees.begin(), callees.end(), (uint32_t)function);
+}
+
+// Tarjan's algorithm with an explicit stack, call chains can be as long as the
+// program
+void CallGraph::FindComponents() {
+	const uint32_t unvisited = UINT32_MAX;
+	size_t count = m_Callees.size();
+
+	struct Frame {
+		uint32_t Function;
+		uint32_t NextCallee;
+	};
+
+	std::vector<uint32_t> index(count, unvisited);
+	std::vector<uint32_t> lowLink(count, 0);
+	std::vector<bool> onStack(count, false);
+	std::vector<uint32_t> stack;
+	std::vector<Frame> frames;
+	uint32_t nextIndex = 0;
+
+	m_Components.assign(count, 0);
+	m_ComponentSizes.clear();
+
+	for (uint32_t root = 0; root < count; root++) {
+		if (index[root] != unvisited)
+			continue;
+
+		frames.push_back({root, 0});
+		while (!frames.empty()) {
+			Frame& frame = frames.back();
+			uint32_t function = frame.Function;
+
+			if (frame.NextCallee == 0) {
+				index[function] = lowLink[function] = nextIndex++;
+				stack.push_back(function);
+				onStack[function] = true;
+			}
+
+			const std::vector<uint32_t>& callees = m_Callees[function];
+			bool descended = false;
+			while (frame.NextCallee < callees.size()) {
+				uint32_t callee = callees[frame.NextCallee++];
+				if (index[callee] == unvisited) {
+					// frame is invalidated by the push
+					frames.push_back({callee, 0});
+					descended = true;
+					break;
+				}
+				if (onStack[callee])
+					lowLink[function] = std::min(lowLink[function], index[callee]);
+			}
+			if (descended)
+				continue;
+
+			if (lowLink[function] == index[function]) {
+				uint32_t component = (uint32_t)m_ComponentSizes.size();
+				uint32_t size = 0;
+				uint32_t member;
+				do {
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = false;
+					m_Components[member] = component;
+					size++;
+				} while (member != function);
+				m_ComponentSizes.push_back(size);
+			}
+
+			frames.pop_back();
+			if (!frames.empty()) {
+				uint32_t caller = frames.back().Function;
+				lowLink[caller] = std::min(lowLink[caller], lowLink[function]);
+			}
+		}
+	}
+
+	m_ComponentCount = m_ComponentSizes.size();
+}
+
+void CallGraph::MarkReachable(uint32_t entry) {
+	m_Reachable.assign(m_Callees.size(), false);
+	m_ReachableCount = 0;
+
+	std::vector<uint32_t> pending = {entry};
+	m_Reachable[entry] = true;
+	while (!pending.empty()) {
+		uint32_t function = pending.back();
+		pending.pop_back();
+		m_ReachableCount++;
+
+		for (uint32_t callee : m_Callees[function]) {
+			if (!m_Reachable[callee]) {
+				m_Reachable[callee] = true;
+				pending.push_back(callee);
+			}
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Parser.h"
+
+// Links every call to the function it refers to, groups mutually recursive
+// functions into strongly connected components and marks the functions that
+// can be reached from the entry point. Later passes only look at reachable
+// functions, so unused helpers are never lowered or emitted.
+class CallGraph {
+public:
+	// A program without the entry function is treated as a library and keeps
+	// all of its functions
+	explicit CallGraph(const ProgramNode& program, const std::string& entry = "Main");
+
+	size_t GetFunctionCount() const { return m_Callees.size(); }
+	// Indices of the functions called by a function, sorted and without duplicates.
+	// Calls to unknown functions are not part of the graph.
+	const std::vector<uint32_t>& GetCallees(size_t function) const { return m_Callees[function]; }
+
+	// Components are numbered in reverse topological order, a component only
+	// calls into itself and components with a lower number
+	uint32_t GetComponent(size_t function) const { return m_Components[function]; }
+	size_t GetComponentCount() const { return m_ComponentCount; }
+	bool IsRecursive(size_t function) const;
+
+	bool IsReachable(size_t function) const { return m_Reachable[function]; }
+	size_t GetReachableCount() const { return m_ReachableCount; }
+private:
+	void FindComponents();
+	void MarkReachable(uint32_t entry);
+
+	std::vector<std::vector<uint32_t>> m_Callees;
+	std::vector<uint32_t> m_Components;
+	std::vector<uint32_t> m_ComponentSizes;
+	std::vector<bool> m_Reachable;
+	size_t m_ComponentCount = 0;
+	size_t m_ReachableCount = 0;
+};
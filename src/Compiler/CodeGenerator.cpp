@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include "CodeGenerator.h"
+#include "Threading/ThreadPool.h"
+#include "Threading/StringInterner.h"
+#include "AstVisitor.h"
+
+enum class FixupKind : uint8_t {
+	CallTarget,
+	StringIndex,
+	ImportIndex
+};
+
+struct Fixup {
+	FixupKind Kind;
+	uint32_t Offset;
+	uint32_t Target; // Function index, interned string or interned import name id
+};
+
+struct FunctionCode {
+	std::vector<uint8_t> Code;
+	std::vector<Fixup> Fixups;
+	std::vector<Diagnostic> Diagnostics;
+	uint32_t LocalCount = 0;
+};
+
+static void WriteU32(std::vector<uint8_t>& out, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		out.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static void WriteU64(std::vector<uint8_t>& out, uint64_t value) {
+	for (int i = 0; i < 8; i++)
+		out.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static void PatchU32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		out[offset + i] = (uint8_t)(value >> (i * 8));
+}
+
+// Interned ids depend on which worker got to a string first, string and import
+// operands are renumbered in order of first use so the output is reproducible
+static uint32_t GetStringIndex(const StringInterner& interner, uint32_t id,
+	std::unordered_map<uint32_t, uint32_t>& indices, std::vector<std::string>& strings) {
+	auto inserted = indices.emplace(id, (uint32_t)strings.size());
+	if (inserted.second)
+		strings.push_back(interner.Get(id));
+	return inserted.first->second;
+}
+
+static void AddDiagnostic(CompilerResult& result, Diagnostic diagnostic) {
+	if (result.Type == ResultType::Success) {
+		result.Type = diagnostic.Kind;
+		result.Offset = diagnostic.Offset;
+	}
+	result.Diagnostics.push_back(std::move(diagnostic));
+}
+
+// Emits a single function. Only reads the shared program, the function index and
+// the semantics of the function and interns string literals and import names,
+// everything else it writes is owned by the FunctionCode it was given. Locals
+// use the slots the semantic analyzer assigned, so sibling blocks share them.
+// Operands are emitted in post-order from the visitor's explicit stack, so
+// nesting depth does not grow the native stack. Anything that can't be lowered
+// becomes a diagnostic instead of code.
+class FunctionEmitter : public AstVisitor<FunctionEmitter> {
+public:
+	FunctionEmitter(const FunctionNode& function, const FunctionSemantics& semantics, const FunctionTable& functions,
+		StringInterner& strings, StringInterner& imports, FunctionCode& out)
+		: m_Function(function), m_Semantics(semantics), m_Functions(functions), m_Strings(strings), m_Imports(imports),
+		m_ImportedNames(semantics.Imports.begin(), semantics.Imports.end()), m_Out(out) {}
+
+	void EmitFunction() {
+		Visit(m_Function);
+
+		// Falling off the end returns void
+		Emit(OpCode::PushVoid);
+		Emit(OpCode::Return);
+		m_Out.LocalCount = std::max(m_Semantics.SlotCount, (uint32_t)m_Function.Parameters.size());
+	}
+
+	// A bare declaration resets its slot, the slot may have been used by a
+	// variable of an earlier block
+	bool EnterDeclaration(const DeclarationExpression& declaration, uint32_t offset) {
+		Emit(OpCode::PushVoid);
+		Emit(OpCode::Store);
+		WriteU32(m_Out.Code, GetLocal(declaration.Identifier, offset));
+		return true;
+	}
+
+	bool EnterInitialization(const InitializationExpression& /*node*/, uint32_t /*offset*/) { return EnterValueContext(); }
+	void LeaveInitialization(const InitializationExpression& initialization, uint32_t offset) {
+		LeaveValueContext();
+		if (initialization.ValueExpression == nullptr)
+			Emit(OpCode::PushVoid);
+		Emit(OpCode::Store);
+		WriteU32(m_Out.Code, GetLocal(initialization.Identifier, offset));
+	}
+
+	bool EnterAssignment(const AssignmentExpression& /*node*/, uint32_t /*offset*/) { return EnterValueContext(); }
+	void LeaveAssignment(const AssignmentExpression& assignment, uint32_t offset) {
+		LeaveValueContext();
+		if (assignment.ValueExpression == nullptr)
+			Emit(OpCode::PushVoid);
+		Emit(OpCode::Store);
+		WriteU32(m_Out.Code, GetLocal(assignment.Identifier, offset));
+	}
+
+	bool EnterReturn(const ReturnExpression& /*node*/, uint32_t /*offset*/) { return EnterValueContext(); }
+	void LeaveReturn(const ReturnExpression& node, uint32_t /*offset*/) {
+		LeaveValueContext();
+		if (node.Value == nullptr)
+			Emit(OpCode::PushVoid);
+		Emit(OpCode::Return);
+	}
+
+	bool EnterCall(const FunctionCallExpression& /*node*/, uint32_t /*offset*/) {
+		// Calls outside of any value are statements, their result is dropped
+		m_CallIsStatement.push_back(m_ValueDepth == 0);
+		return EnterValueContext();
+	}
+
+	// Callees of other modules are called through the import table, the module
+	// that defines them is only known when linking
+	void LeaveCall(const FunctionCallExpression& call, uint32_t offset) {
+		LeaveValueContext();
+		uint32_t callee = m_Functions.Find(call.Name);
+		if (callee != FunctionTable::s_NoFunction) {
+			Emit(OpCode::Call);
+			m_Out.Fixups.push_back({FixupKind::CallTarget, (uint32_t)m_Out.Code.size(), callee});
+		} else if (m_ImportedNames.count(call.Name) != 0) {
+			Emit(OpCode::CallImport);
+			uint32_t id = m_Imports.Intern(call.Name);
+			if (id != StringInterner::s_InvalidId)
+				m_Out.Fixups.push_back({FixupKind::ImportIndex, (uint32_t)m_Out.Code.size(), id});
+			else
+				Report(ResultType::Failure, offset, "too many distinct imported functions");
+		} else {
+			Emit(OpCode::Call);
+			Report(ResultType::UnresolvedSymbol, offset, "no function named " + call.Name);
+		}
+		WriteU32(m_Out.Code, UINT32_MAX);
+		WriteU32(m_Out.Code, (uint32_t)call.Arguments.size());
+
+		if (m_CallIsStatement.back())
+			Emit(OpCode::Pop);
+		m_CallIsStatement.pop_back();
+	}
+
+	bool EnterValue(const ValueExpression& value, uint32_t offset) {
+		switch (value.Type) {
+			case ValueExpressionType::Literal:
+			case ValueExpressionType::IntLiteral:
+				Emit(OpCode::PushInt);
+				WriteU64(m_Out.Code, (uint64_t)value.ValueLiteral);
+				break;
+			case ValueExpressionType::StringLiteral: {
+				Emit(OpCode::PushString);
+				// The interner is full, the id can't be resolved later
+				uint32_t id = m_Strings.Intern(value.StringLiteral);
+				if (id != StringInterner::s_InvalidId)
+					m_Out.Fixups.push_back({FixupKind::StringIndex, (uint32_t)m_Out.Code.size(), id});
+				else
+					Report(ResultType::Failure, offset, "too many distinct string literals");
+				WriteU32(m_Out.Code, 0);
+				break;
+			}
+			case ValueExpressionType::Variable:
+				Emit(OpCode::Load);
+				WriteU32(m_Out.Code, GetLocal(value.VariableName, offset));
+				break;
+			case ValueExpressionType::FloatLiteral:
+				Report(ResultType::Unsupported, offset, "floating point values are not supported yet");
+				break;
+			case ValueExpressionType::FunctionCall:
+				// A call without its node, the parser never produces one
+				Report(ResultType::Failure, offset, "call without a callee");
+				break;
+		}
+		return true;
+	}
+
+	bool EnterUnaryOperation(const UnaryOperationExpression& /*node*/, uint32_t offset) {
+		Report(ResultType::Unsupported, offset, "unary operations are not supported yet");
+		return false;
+	}
+
+	bool EnterBinaryOperation(const BinaryOperationExpression& /*node*/, uint32_t offset) {
+		Report(ResultType::Unsupported, offset, "binary operations are not supported yet");
+		return false;
+	}
+
+	// The parser skips conditions and bodies for now, emitting the statement
+	// without them would run the body unconditionally.
+	bool EnterWhile(const WhileExpression& /*node*/, uint32_t offset) { return ReportControlFlow("while", offset); }
+	bool EnterIf(const IfExpression& /*node*/, uint32_t offset) { return ReportControlFlow("if", offset); }
+	bool EnterElse(const ElseExpression& /*node*/, uint32_t offset) { return ReportControlFlow("else", offset); }
+private:
+	void Emit(OpCode op) {
+		m_Out.Code.push_back((uint8_t)op);
+	}
+
+	void Report(ResultType kind, uint32_t offset, std::string message) {
+		m_Out.Diagnostics.push_back({kind, offset, TokenType::Invalid, TokenType::Invalid, std::move(message)});
+	}
+
+	bool ReportControlFlow(const char* keyword, uint32_t offset) {
+		Report(ResultType::Unsupported, offset, std::string(keyword) + " statements are not supported yet");
+		return false;
+	}
+
+	bool EnterValueContext() {
+		m_ValueDepth++;
+		return true;
+	}
+
+	void LeaveValueContext() {
+		m_ValueDepth--;
+	}
+
+	uint32_t GetLocal(const std::string& name, uint32_t offset) {
+		uint32_t slot = m_Semantics.GetSlot(m_Function, offset);
+		if (slot != FunctionSemantics::s_NoSlot)
+			return slot;
+		Report(ResultType::UnresolvedSymbol, offset, "no variable named " + name);
+		return 0;
+	}
+
+	const FunctionNode& m_Function;
+	const FunctionSemantics& m_Semantics;
+	const FunctionTable& m_Functions;
+	StringInterner& m_Strings;
+	StringInterner& m_Imports;
+	std::unordered_set<std::string> m_ImportedNames;
+	FunctionCode& m_Out;
+	uint32_t m_ValueDepth = 0;
+	std::vector<bool> m_CallIsStatement;
+};
+
+bool FunctionTable::Add(const std::string& name, uint32_t index) {
+	uint32_t id = m_Names.Intern(name);
+	if (id == StringInterner::s_InvalidId)
+		return false;
+	if (id >= m_Indices.size())
+		m_Indices.resize((size_t)id + 1, s_NoFunction);
+	if (m_Indices[id] == s_NoFunction)
+		m_Indices[id] = index;
+	return true;
+}
+
+uint32_t FunctionTable::Find(const std::string& name) const {
+	uint32_t id = m_Names.Find(name.data(), name.size());
+	return id < m_Indices.size() ? m_Indices[id] : s_NoFunction;
+}
+
+CodeGenerator::CodeGenerator(unsigned threadCount) : m_ThreadCount(threadCount == 0 ? 1 : threadCount) {
+
+}
+
+CompilerResult CodeGenerator::Generate(const ProgramNode& program, const CallGraph& callGraph,
+	const std::vector<FunctionSemantics>& semantics, BytecodeModule& module) {
+	if (semantics.size() != program.Functions.size()) {
+		CompilerResult result(ResultType::Failure);
+		result.Diagnostics.push_back({ResultType::Failure, 0, TokenType::Invalid, TokenType::Invalid,
+			"the program has to be analyzed before code generation"});
+		return result;
+	}
+
+	// Only reachable functions are lowered, they keep their relative source order
+	std::vector<const FunctionNode*> functions;
+	std::vector<const FunctionSemantics*> functionSemantics;
+	functions.reserve(callGraph.GetReachableCount());
+	functionSemantics.reserve(callGraph.GetReachableCount());
+	for (size_t i = 0; i < program.Functions.size(); i++) {
+		if (callGraph.IsReachable(i)) {
+			functions.push_back(program.Functions[i]);
+			functionSemantics.push_back(&semantics[i]);
+		}
+	}
+
+	FunctionTable functionTable;
+	for (size_t i = 0; i < functions.size(); i++) {
+		if (!functionTable.Add(functions[i]->Name, (uint32_t)i)) {
+			CompilerResult result(ResultType::Failure, functions[i]->Offset);
+			result.Diagnostics.push_back({ResultType::Failure, functions[i]->Offset, TokenType::Invalid, TokenType::Invalid,
+				"too many distinct function names"});
+			return result;
+		}
+	}
+
+	// Shared by all workers, equal literals end up as one module string and
+	// every imported function gets one import entry
+	StringInterner strings(m_ThreadCount);
+	StringInterner imports(m_ThreadCount);
+	std::vector<FunctionCode> codes(functions.size());
+	std::unique_ptr<ThreadPool> pool;
+	if (m_ThreadCount > 1 && functions.size() > 1)
+		pool.reset(new ThreadPool(m_ThreadCount));
+	ForEachFunction(functions, pool.get(), [&](size_t i, const FunctionNode& function) {
+		FunctionEmitter emitter(function, *functionSemantics[i], functionTable, strings, imports, codes[i]);
+		emitter.EmitFunction();
+	});
+
+	// Diagnostics are reported in source order too, a failed module is not merged
+	CompilerResult result(ResultType::Success);
+	for (auto& code : codes) {
+		for (Diagnostic& diagnostic : code.Diagnostics)
+			AddDiagnostic(result, std::move(diagnostic));
+	}
+	if (result.Type != ResultType::Success)
+		return result;
+
+	// Merge in source order
+	module = BytecodeModule();
+	size_t codeSize = 0;
+	for (auto& code : codes)
+		codeSize += code.Code.size();
+	module.Code.reserve(codeSize);
+	module.Functions.resize(functions.size());
+
+	for (size_t i = 0; i < functions.size(); i++) {
+		BytecodeFunction& function = module.Functions[i];
+		function.Name = functions[i]->Name;
+		function.Offset = (uint32_t)module.Code.size();
+		function.ParameterCount = (uint32_t)functions[i]->Parameters.size();
+		function.LocalCount = codes[i].LocalCount;
+		module.Code.insert(module.Code.end(), codes[i].Code.begin(), codes[i].Code.end());
+	}
+
+	// Resolve fixups now that the final layout is known
+	std::unordered_map<uint32_t, uint32_t> stringIndices;
+	std::unordered_map<uint32_t, uint32_t> importIndices;
+	for (size_t i = 0; i < functions.size(); i++) {
+		uint32_t base = module.Functions[i].Offset;
+		for (const Fixup& fixup : codes[i].Fixups) {
+			size_t offset = base + fixup.Offset;
+			switch (fixup.Kind) {
+				case FixupKind::CallTarget:
+					PatchU32(module.Code, offset, module.Functions[fixup.Target].Offset);
+					break;
+				case FixupKind::StringIndex:
+					PatchU32(module.Code, offset, GetStringIndex(strings, fixup.Target, stringIndices, module.Strings));
+					break;
+				case FixupKind::ImportIndex:
+					PatchU32(module.Code, offset, GetStringIndex(imports, fixup.Target, importIndices, module.Imports));
+					break;
+			}
+		}
+	}
+
+	return result;
+}
+
+CompilerResult CodeGenerator::GenerateFunction(const FunctionNode& function, const FunctionSemantics& semantics,
+	const FunctionTable& functions, BytecodeChunk& chunk) {
+	FunctionCode code;
+	StringInterner strings(1);
+	StringInterner imports(1);
+	FunctionEmitter emitter(function, semantics, functions, strings, imports, code);
+	emitter.EmitFunction();
+
+	CompilerResult result(ResultType::Success);
+	for (Diagnostic& diagnostic : code.Diagnostics)
+		AddDiagnostic(result, std::move(diagnostic));
+	if (result.Type != ResultType::Success)
+		return result;
+
+	// There is no module layout, calls keep the callee index
+	chunk = BytecodeChunk();
+	std::unordered_map<uint32_t, uint32_t> stringIndices;
+	std::unordered_map<uint32_t, uint32_t> importIndices;
+	for (const Fixup& fixup : code.Fixups) {
+		switch (fixup.Kind) {
+			case FixupKind::CallTarget:
+				PatchU32(code.Code, fixup.Offset, fixup.Target);
+				break;
+			case FixupKind::StringIndex:
+				PatchU32(code.Code, fixup.Offset, GetStringIndex(strings, fixup.Target, stringIndices, chunk.Strings));
+				break;
+			case FixupKind::ImportIndex:
+				PatchU32(code.Code, fixup.Offset, GetStringIndex(imports, fixup.Target, importIndices, chunk.Imports));
+				break;
+		}
+	}
+
+	chunk.Code = std::move(code.Code);
+	chunk.LocalCount = code.LocalCount;
+	return result;
+}
+
+std::vector<uint8_t> BytecodeModule::Serialize() const {
+	std::vector<uint8_t> out;
+	for (char c : {'C', 'S', 'B', '2'})
+		out.push_back((uint8_t)c);
+
+	WriteU32(out, (uint32_t)Functions.size());
+	for (const BytecodeFunction& function : Functions) {
+		WriteU32(out, (uint32_t)function.Name.size());
+		out.insert(out.end(), function.Name.begin(), function.Name.end());
+		WriteU32(out, function.Offset);
+		WriteU32(out, function.ParameterCount);
+		WriteU32(out, function.LocalCount);
+	}
+
+	WriteU32(out, (uint32_t)Strings.size());
+	for (const std::string& string : Strings) {
+		WriteU32(out, (uint32_t)string.size());
+		out.insert(out.end(), string.begin(), string.end());
+	}
+
+	WriteU32(out, (uint32_t)Imports.size());
+	for (const std::string& name : Imports) {
+		WriteU32(out, (uint32_t)name.size());
+		out.insert(out.end(), name.begin(), name.end());
+	}
+
+	WriteU32(out, (uint32_t)Code.size());
+	out.insert(out.end(), Code.begin(), Code.end());
+	return out;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Parser.h"
+#include "CallGraph.h"
+#include "SemanticAnalyzer.h"
+#include "ErrorHandling/CompilerResult.h"
+#include "Threading/StringInterner.h"
+
+enum class OpCode : uint8_t {
+	Nop = 0,
+	PushInt,		// i64 value
+	PushString,		// u32 string index
+	PushVoid,
+	Load,			// u32 slot
+	Store,			// u32 slot
+	Pop,
+	Call,			// u32 code offset, u32 argument count
+	Jump,			// i32 offset relative to the next instruction
+	JumpIfFalse,	// i32 offset relative to the next instruction
+	Return,
+	CallImport		// u32 import index, u32 argument count
+};
+
+struct BytecodeFunction {
+	std::string Name;
+	uint32_t Offset = 0;
+	uint32_t ParameterCount = 0;
+	uint32_t LocalCount = 0;
+};
+
+// Serialized as "CSB2", the function table, the strings, the imports and the
+// code. Imports name the functions of other modules the code calls, linking
+// resolves them by name against the function tables of those modules.
+struct BytecodeModule {
+	std::vector<uint8_t> Code;
+	std::vector<BytecodeFunction> Functions;
+	std::vector<std::string> Strings;
+	std::vector<std::string> Imports;
+
+	std::vector<uint8_t> Serialize() const;
+};
+
+// A single function lowered on its own, used to tier up at run time. Call
+// operands hold the index of the callee in the program instead of a code
+// offset (UINT32_MAX if unknown), string operands index Strings and import
+// operands index Imports.
+struct BytecodeChunk {
+	std::vector<uint8_t> Code;
+	std::vector<std::string> Strings;
+	std::vector<std::string> Imports;
+	uint32_t LocalCount = 0;
+};
+
+// Function names of a program. Every name is interned once up front, calls are
+// then resolved by looking the name up in the interner, which never locks, and
+// indexing with its id, so workers share the table without copying it.
+class FunctionTable {
+public:
+	static constexpr uint32_t s_NoFunction = UINT32_MAX;
+
+	// The first definition of a name wins. False if the name can't be interned.
+	bool Add(const std::string& name, uint32_t index);
+	// s_NoFunction if no function has the name
+	uint32_t Find(const std::string& name) const;
+	size_t GetSize() const { return m_Names.GetSize(); }
+private:
+	// A single shard hands out ids 0, 1, 2, ... in insertion order
+	StringInterner m_Names{1};
+	std::vector<uint32_t> m_Indices; // By name id
+};
+
+// Lowers every function to bytecode independently on a thread pool. Each worker
+// writes into its own buffer and records fixups for everything that depends on
+// the final layout (call targets, string and import indices); the buffers are
+// then merged in source order so the result does not depend on the thread
+// count. Functions the call graph marks as unreachable are left out of the
+// module.
+class CodeGenerator {
+public:
+	explicit CodeGenerator(unsigned threadCount = std::thread::hardware_concurrency());
+
+	// Fails with a diagnostic for everything that can't be lowered (unknown
+	// names, constructs the parser does not fully support yet), the module is
+	// only filled in on success. Locals and imported callees come from the
+	// semantics, one entry per function of the program like
+	// CompileUnit::GetSemantics.
+	CompilerResult Generate(const ProgramNode& program, const CallGraph& callGraph,
+		const std::vector<FunctionSemantics>& semantics, BytecodeModule& module);
+	static CompilerResult GenerateFunction(const FunctionNode& function, const FunctionSemantics& semantics,
+		const FunctionTable& functions, BytecodeChunk& chunk);
+private:
+	unsigned m_ThreadCount;
+};
@@ -1,51 +1,127 @@
 #include <iostream>
 #include "Lexer.h"
+#include "Unicode.h"
+
+enum class CharClass : uint8_t {
+	Other,
+	Space,
+	Letter,
+	Digit,
+	NonAscii
+};
+
+// Class and single character token of every byte value, so the ASCII path
+// costs one table load per character
+struct CharTable {
+	constexpr CharTable() : Classes(), Tokens() {
+		for (int c = 0; c < 256; c++) {
+			if (c >= 0x80)
+				Classes[c] = CharClass::NonAscii;
+			else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+				Classes[c] = CharClass::Letter;
+			else if (c >= '0' && c <= '9')
+				Classes[c] = CharClass::Digit;
+			else if (c == ' ' || (c >= '\t' && c <= '\r'))
+				Classes[c] = CharClass::Space;
+		}
+
+		Tokens[';'] = TokenType::Semi;
+		Tokens['{'] = TokenType::CurlyOpen;
+		Tokens['}'] = TokenType::CurlyClose;
+		Tokens['('] = TokenType::ParenOpen;
+		Tokens[')'] = TokenType::ParenClose;
+		Tokens['['] = TokenType::SquareOpen;
+		Tokens[']'] = TokenType::SquareClose;
+		Tokens[','] = TokenType::Comma;
+		Tokens['+'] = TokenType::Plus;
+		Tokens['-'] = TokenType::Minus;
+		Tokens['*'] = TokenType::Star;
+		Tokens['/'] = TokenType::Slash;
+		Tokens['%'] = TokenType::Percent;
+		Tokens['='] = TokenType::Equal;
+		Tokens['>'] = TokenType::Greater;
+		Tokens['<'] = TokenType::Less;
+		Tokens['!'] = TokenType::Exclamation;
+		Tokens['&'] = TokenType::Ampersand;
+		Tokens['|'] = TokenType::Pipe;
+	}
+
+	CharClass Classes[256];
+	TokenType Tokens[256];
+};
+
+static constexpr CharTable s_Chars;
+
+bool Lexer::s_TraceTokens = false;
+
+Lexer::Lexer(std::string input) : m_Input(std::move(input)), m_Position(0) {
+	// Validated once up front, the rest of the lexer only decodes
+	m_InvalidUtf8Offset = Unicode::FindInvalidUtf8(m_Input.data(), m_Input.length());
+}
 
 Token Lexer::Consume() {
-	Token t = At(m_Position, true);
-	m_Position++;
-	std::cout << "Token Type: " << Lexer::TokenTypeToString(t.Type) << ", Content: " << t.Content << std::endl;
+	Token t;
+	if (!m_Lookahead.empty()) {
+		t = std::move(m_Lookahead.front());
+		m_Lookahead.pop_front();
+	} else {
+		t = Lex(m_Position);
+	}
+	if (s_TraceTokens)
+		std::cout << "Token Type: " << Lexer::TokenTypeToString(t.Type) << ", Content: " << t.Content << std::endl;
 	return t;
 }
 
 Token Lexer::Peek(int offset) {
-	Token t = At(m_Position + offset, false);
-	return t;
+	// Tokens are lexed once and kept until they are consumed
+	size_t count = offset < 1 ? 1 : (size_t)offset;
+	while (m_Lookahead.size() < count)
+		m_Lookahead.push_back(Lex(m_Position));
+	return m_Lookahead[count - 1];
 }
 
-int Lexer::SkipWhitespace() {
-	size_t pos = m_Position;
-	while (pos < m_Input.length() && std::isspace(m_Input[pos])) {
+size_t Lexer::SkipWhitespace(size_t pos) {
+	size_t start = pos;
+	while (pos < m_Input.length() && s_Chars.Classes[(uint8_t)m_Input[pos]] == CharClass::Space) {
 		pos++;
 	}
-	return pos - m_Position;
+	return pos - start;
 }
 
-std::string Lexer::GetIdentifier() {
-	size_t start = m_Position, pos = m_Position;
-	while (pos < m_Input.length() && (std::isalpha(m_Input[pos]) || isdigit(m_Input[pos]))) {
-		pos++;
+std::string Lexer::GetIdentifier(size_t pos) {
+	size_t start = pos;
+	while (pos < m_Input.length()) {
+		CharClass type = s_Chars.Classes[(uint8_t)m_Input[pos]];
+		if (type == CharClass::Letter || type == CharClass::Digit) {
+			pos++;
+			continue;
+		}
+		if (type != CharClass::NonAscii || pos >= m_InvalidUtf8Offset)
+			break;
+
+		size_t next = pos;
+		if (!Unicode::IsXidContinue(Unicode::DecodeUtf8(m_Input, next)))
+			break;
+		pos = next;
 	}
 	return m_Input.substr(start, pos - start);
 }
 
-std::string Lexer::GetNumber() {
-	size_t start = m_Position, pos = m_Position;
-	while (pos < m_Input.length() && isdigit(m_Input[pos])) {
+std::string Lexer::GetNumber(size_t pos) {
+	size_t start = pos;
+	while (pos < m_Input.length() && s_Chars.Classes[(uint8_t)m_Input[pos]] == CharClass::Digit) {
 		pos++;
 	}
 	return m_Input.substr(start, pos - start);
 }
 
-std::string Lexer::GetString() {
-	size_t start = m_Position + 1, pos = m_Position + 1;
+std::string Lexer::GetString(size_t pos) {
+	size_t start = pos + 1;
+	pos = start;
 	while (pos < m_Input.length() && m_Input[pos] != '"') {
 		pos++;
 	}
-	if (pos < m_Input.length() && m_Input[pos] == '"') {
-		pos++;
-	}
-	return m_Input.substr(start, pos - start - 1);
+	return m_Input.substr(start, pos - start);
 }
 
 std::string Lexer::TokenTypeToString(TokenType type) {
@@ -73,91 +149,77 @@ std::string Lexer::TokenTypeToString(TokenType type) {
         case TokenType::Exclamation: return "Exclamation";
         case TokenType::Ampersand: return "Ampersand";
         case TokenType::Pipe: return "Pipe";
+        case TokenType::EndOfFile: return "EndOfFile";
         default: return "Unknown";
     }
 }
 
-Token Lexer::At(int pos, bool consume) {
+Token Lexer::At(size_t pos, bool consume) {
+	Token token = Lex(pos);
+	if (consume) {
+		m_Position = pos;
+		m_Lookahead.clear();
+	}
+	return token;
+}
+
+Token Lexer::Lex(size_t& pos) {
 	Token token;
 
+	pos += SkipWhitespace(pos);
+	token.Offset = (uint32_t)pos;
+
 	if (pos >= m_Input.length()) {
-		token.Type = TokenType::Invalid;
+		token.Type = TokenType::EndOfFile;
 		return token;
 	}
 
-	pos += SkipWhitespace();
-	char currentChar = m_Input[pos];
-
-	if (std::isalpha(currentChar)) {
-		token.Type = TokenType::Identifier;
-		token.Content = GetIdentifier();
-		m_Position += token.Content.length() * consume;
-	} else if (isdigit(currentChar)) {
-		token.Type = TokenType::IntLit;
-		token.Content = GetNumber();
-		m_Position += token.Content.length() * consume;
-	} else if (currentChar == '"') {
-		token.Type = TokenType::StringLit;
-		token.Content = GetString();
-		m_Position += (1 +token.Content.length()) * consume;
-	} else if (currentChar == ';') {
-		token.Type = TokenType::Semi;
-		token.Content = ";";
-	} else if (currentChar == '{') {
-		token.Type = TokenType::CurlyOpen;
-		token.Content = "{";
-	} else if (currentChar == '}') {
-		token.Type = TokenType::CurlyClose;
-		token.Content = "}";
-	} else if (currentChar == '(') {
-		token.Type = TokenType::ParenOpen;
-		token.Content = "(";
-	} else if (currentChar == ')') {
-		token.Type = TokenType::ParenClose;
-		token.Content = ")";
-	} else if (currentChar == '[') {
-		token.Type = TokenType::SquareOpen;
-		token.Content = "[";
-	} else if (currentChar == ']') {
-		token.Type = TokenType::SquareClose;
-		token.Content = "]";
-	} else if (currentChar == ',') {
-		token.Type = TokenType::Comma;
-		token.Content = ",";
-	} else if (currentChar == '+') {
-		token.Type = TokenType::Plus;
-		token.Content = "+";
-	} else if (currentChar == '-') {
-		token.Type = TokenType::Minus;
-		token.Content = "-";
-	} else if (currentChar == '*') {
-		token.Type = TokenType::Star;
-		token.Content = "*";
-	} else if (currentChar == '/') {
-		token.Type = TokenType::Slash;
-		token.Content = "/";
-	} else if (currentChar == '%') {
-		token.Type = TokenType::Percent;
-		token.Content = "%";
-	} else if (currentChar == '=') {
-		token.Type = TokenType::Equal;
-		token.Content = "=";
-	} else if (currentChar == '>') {
-		token.Type = TokenType::Greater;
-		token.Content = ">";
-	} else if (currentChar == '<') {
-		token.Type = TokenType::Less;
-		token.Content = "<";
-	} else if (currentChar == '!') {
-		token.Type = TokenType::Exclamation;
-		token.Content = "!";
-	} else if (currentChar == '&') {
-		token.Type = TokenType::Ampersand;
-		token.Content = "&";
-	} else if (currentChar == '|') {
-		token.Type = TokenType::Pipe;
-		token.Content = "|";
+	uint8_t currentChar = (uint8_t)m_Input[pos];
+	size_t length = 1;
+
+	switch (s_Chars.Classes[currentChar]) {
+		case CharClass::Letter:
+			token.Type = TokenType::Identifier;
+			token.Content = GetIdentifier(pos);
+			length = token.Content.length();
+			break;
+		case CharClass::Digit:
+			token.Type = TokenType::IntLit;
+			token.Content = GetNumber(pos);
+			length = token.Content.length();
+			break;
+		case CharClass::NonAscii: {
+			if (pos >= m_InvalidUtf8Offset) {
+				token.Content = (char)currentChar;
+				break;
+			}
+
+			size_t end = pos;
+			if (Unicode::IsXidStart(Unicode::DecodeUtf8(m_Input, end))) {
+				token.Type = TokenType::Identifier;
+				token.Content = GetIdentifier(pos);
+				length = token.Content.length();
+			} else {
+				// Keep the whole code point in the invalid token
+				token.Content = m_Input.substr(pos, end - pos);
+				length = end - pos;
+			}
+			break;
+		}
+		default:
+			if (currentChar == '"') {
+				token.Type = TokenType::StringLit;
+				token.Content = GetString(pos);
+				length = token.Content.length() + 1;
+				if (pos + length < m_Input.length())
+					length++; // Closing quote
+			} else {
+				token.Type = s_Chars.Tokens[currentChar];
+				token.Content = (char)currentChar;
+			}
+			break;
 	}
 
+	pos += length;
 	return token;
 }
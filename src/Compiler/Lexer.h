@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <utility>
 
@@ -26,28 +28,43 @@ enum class TokenType {
     Less,
     Exclamation,
     Ampersand,
-    Pipe
+    Pipe,
+    EndOfFile
 };
 
 struct Token {
 	TokenType Type = TokenType::Invalid;
+	uint32_t Offset = 0; // Byte offset into the source, resolved to line/column through LineTable
 	std::string Content;
 };
 
+// The offset lives in the padding after Type, so tokens stay the same size
+static_assert(sizeof(Token) == sizeof(std::string) + 2 * sizeof(uint32_t), "Token grew");
+
 class Lexer {
 public:
-	explicit Lexer(std::string  input) : m_Input(std::move(input)), m_Position(0) {}
+	explicit Lexer(std::string input);
 
 	Token Consume();
 	Token Peek(int offset = 1);
-	Token At(int pos, bool consume);
+	Token At(size_t pos, bool consume);
+	const std::string& GetInput() const { return m_Input; }
+	// Offset of the first malformed UTF-8 sequence, the input length if there is none
+	size_t GetInvalidUtf8Offset() const { return m_InvalidUtf8Offset; }
+	bool IsValidUtf8() const { return m_InvalidUtf8Offset == m_Input.length(); }
     static std::string TokenTypeToString(TokenType type);
+	static void SetTraceTokens(bool trace) { s_TraceTokens = trace; }
 private:
+	static bool s_TraceTokens;
+
 	std::string m_Input;
-	size_t m_Position;
+	size_t m_Position; // End of the last lexed token, including lookahead
+	std::deque<Token> m_Lookahead;
+	size_t m_InvalidUtf8Offset;
 
-	int SkipWhitespace();
-	std::string GetIdentifier();
-	std::string GetNumber();
-	std::string GetString();
+	Token Lex(size_t& pos);
+	size_t SkipWhitespace(size_t pos);
+	std::string GetIdentifier(size_t pos);
+	std::string GetNumber(size_t pos);
+	std::string GetString(size_t pos);
 };
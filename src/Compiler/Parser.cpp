@@ -1,5 +1,5 @@
 #include <algorithm>
-#include <iostream>
+#include <climits>
 #include "Parser.h"
 
 static const std::vector<std::string> s_Reserved {
@@ -36,28 +36,73 @@ Parser::Parser(Lexer& lexer) : m_Lexer(lexer) {
 }
 
 CompilerResult Parser::Parse() {
-	bool parsing = true;
-	while(parsing) {
-		m_Token = m_Lexer.Consume();
-		if(m_Token.Type == TokenType::Invalid)
-			return ResultType::InvalidToken;
-		continue;
+	// Offsets are 32 bit, anything past them couldn't be reported or resolved
+	if (m_Lexer.GetInput().size() >= UINT32_MAX) {
+		CompilerResult result(ResultType::Unsupported, 0);
+		result.Diagnostics.push_back({ResultType::Unsupported, 0, TokenType::Invalid, TokenType::Invalid,
+			"source files of 4 GiB or more are not supported"});
+		return result;
+	}
 
-		if(m_Token.Type == TokenType::Invalid) {
-			parsing = false;
-			continue;
-		}
+	// Nothing after a malformed byte can be trusted, report it alone
+	if (!m_Lexer.IsValidUtf8()) {
+		CompilerResult result(ResultType::InvalidEncoding, (uint32_t)m_Lexer.GetInvalidUtf8Offset());
+		result.Diagnostics.push_back({ResultType::InvalidEncoding, result.Offset, TokenType::Invalid, TokenType::Invalid,
+			"malformed UTF-8"});
+		return result;
+	}
 
-		if(m_CurrentFunction == nullptr && m_Token.Type == TokenType::Identifier) {
-			bool success = ParseFunctionHeader();
-			if(!success)
-				return ResultType::InvalidSyntax;
+	m_Token = m_Lexer.Consume();
+	while (m_Token.Type != TokenType::EndOfFile) {
+		if (!ParseFunctionHeader() || !ParseFunction()) {
+			delete m_CurrentFunction;
+			m_CurrentFunction = nullptr;
+			m_CurrentBlock = nullptr;
+
+			// Skip the rest of the broken function, a stray '}' is skipped as well
+			Synchronize();
 		}
-
-		ParseFunction();
+		m_Token = m_Lexer.Consume();
 	}
 
-	return ResultType::Success;
+	if (m_Diagnostics.empty())
+		return ResultType::Success;
+
+	CompilerResult result(m_Diagnostics.front().Kind, m_Diagnostics.front().Offset);
+	result.Diagnostics = std::move(m_Diagnostics);
+	m_Diagnostics.clear();
+	return result;
+}
+
+void Parser::ReportError(TokenType expected) {
+	ResultType kind = m_Token.Type == TokenType::Invalid ? ResultType::InvalidToken : ResultType::InvalidSyntax;
+	m_Diagnostics.push_back({kind, m_Token.Offset, expected, m_Token.Type});
+}
+
+bool Parser::Expect(TokenType type) {
+	if (m_Token.Type == type)
+		return true;
+	ReportError(type);
+	return false;
+}
+
+bool Parser::Synchronize() {
+	int depth = 0;
+	while (m_Token.Type != TokenType::EndOfFile) {
+		if (m_Token.Type == TokenType::CurlyOpen) {
+			depth++;
+		} else if (m_Token.Type == TokenType::CurlyClose) {
+			// An unmatched '}' still has to close the current block
+			if (depth == 0)
+				return true;
+			if (--depth == 0)
+				return false;
+		} else if (m_Token.Type == TokenType::Semi && depth == 0) {
+			return false;
+		}
+		m_Token = m_Lexer.Consume();
+	}
+	return true;
 }
 
 bool Parser::IsReserved(const std::string& t) {
@@ -78,122 +123,29 @@ bool Parser::IsDataType(const std::string &t) {
 	return false;
 }
 
-void Indent(int indent) {
-	for(int i = 0; i < indent; i++)
-		std::cout << ' ';
-}
-
-void Parser::PrintExpression(Expression* expression, int indent) {
-	if(expression == nullptr) {
-		std::cout << std::endl;
-		return;
-	}
-	switch (expression->Type) {
-		case ExpressionType::Declaration: {
-			Indent(indent + 2);
-			DeclarationExpression* dec = reinterpret_cast<DeclarationExpression*>(expression->Data);
-			std::cout << "type: " << dec->Type << ", name: " << dec->Identifier << std::endl;
-			break;
-		}
-		case ExpressionType::Assignment:
-			break;
-		case ExpressionType::DeclarationWithAssignment: {
-			Indent(indent + 2);
-			InitializationExpression* dec = reinterpret_cast<InitializationExpression*>(expression->Data);
-			std::cout << "type: " << dec->Type << ", name: " << dec->Identifier << std::endl;
-			Indent(indent + 4);
-			std::cout << "value: ";
-			PrintExpression(dec->ValueExpression, 0);
-			break;
-		}
-		case ExpressionType::Block:
-			PrintBlockExpression(reinterpret_cast<BlockExpression*>(expression->Data), indent);
-			break;
-		case ExpressionType::FunctionCall:
-			Indent(indent + 2);
-			std::cout << "call: " << reinterpret_cast<FunctionCallExpression*>(expression->Data)->Name << std::endl;
-			break;
-		case ExpressionType::Value:
-			break;
-		case ExpressionType::UnaryOperation:
-			break;
-		case ExpressionType::BinaryOperation:
-			break;
-		case ExpressionType::Return: {
-			Indent(indent + 2);
-			std::cout << "return: " << std::endl;
-
-			ReturnExpression* returnExpression = reinterpret_cast<ReturnExpression*>(expression->Data);
-			if(returnExpression->Value == nullptr) {
-				Indent(indent + 4);
-				std::cout << "void" << std::endl;
-			} else {
-				Expression ex = Expression{ExpressionType::Return, (void*)returnExpression->Value};
-				PrintExpression(&ex, indent + 4);
-			}
-			break;
-		}
-		case ExpressionType::While: {
-			Indent(indent + 2);
-			std::cout << "while: " << std::endl;
-
-			WhileExpression* whileExpression = reinterpret_cast<WhileExpression*>(expression->Data);
-			PrintExpression(whileExpression->ConditionExpression, indent + 4);
-			PrintExpression(whileExpression->BodyExpression, indent + 4);
-			break;
-		}
-		case ExpressionType::If:{
-			Indent(indent + 2);
-			std::cout << "if: " << std::endl;
-
-			IfExpression* ifExpression = reinterpret_cast<IfExpression*>(expression->Data);
-			PrintExpression(ifExpression->ConditionExpression, indent + 4);
-			PrintExpression(ifExpression->BodyExpression, indent + 4);
-			break;
-		}
-		case ExpressionType::Else:{
-			Indent(indent + 2);
-			std::cout << "else: " << std::endl;
-
-			ElseExpression* elseExpression = reinterpret_cast<ElseExpression*>(expression->Data);
-			PrintExpression(elseExpression->BodyExpression, indent + 4);
-			break;
-		}
-	}
-}
-
-void Parser::PrintBlockExpression(BlockExpression* expression, int indent) {
-	Indent(indent);
-	std::cout << "Block" << std::endl;
-	for(auto& subExpression : expression->Expressions) {
-		PrintExpression(&subExpression, indent + 2);
-	}
-}
-
-void Parser::PrintProgramTree() {
-	for(FunctionNode* function : m_ProgramNode.Functions) {
-		Indent(2);
-
-		std::cout << "Function: " << function->Name << std::endl;
-		PrintBlockExpression(&function->Block, 4);
-	}
+bool Parser::IsFunctionName(const std::string &t) {
+	return m_FunctionNames.find(t) != m_FunctionNames.end();
 }
 
-bool Parser::IsFunctionName(const std::string &t) {
-	for(auto& fn : m_ProgramNode.Functions)
-		if(fn->Name == t)
-			return true;
-	return false;
+// Functions may be called before they are defined, so an identifier followed by
+// '(' is a call as well. The call graph resolves the name later.
+bool Parser::IsCallStart() {
+	if (m_Token.Type != TokenType::Identifier || IsReserved(m_Token.Content) || IsDataType(m_Token.Content))
+		return false;
+	return IsFunctionName(m_Token.Content) || m_Lexer.Peek().Type == TokenType::ParenOpen;
 }
 
 bool Parser::ParseFunction() {
+	bool advance = true;
 	while (true) {
-		m_Token = m_Lexer.Consume();
+		if (advance)
+			m_Token = m_Lexer.Consume();
+		advance = true;
 
 		// Block Open
 		if(m_Token.Type == TokenType::CurlyOpen) {
 			BlockExpression* newExpression = new BlockExpression(m_CurrentBlock);
-			m_CurrentBlock->Expressions.push_back({ExpressionType::Block, newExpression});
+			m_CurrentBlock->Expressions.push_back({ExpressionType::Block, m_Token.Offset, newExpression});
 			m_CurrentBlock = newExpression;
 			continue;
 		}
@@ -201,7 +153,17 @@ bool Parser::ParseFunction() {
 		// Block Close
 		if(m_Token.Type == TokenType::CurlyClose) {
 			if(m_CurrentBlock == &m_CurrentFunction->Block) {
-				m_ProgramNode.Functions.push_back(m_CurrentFunction);
+				m_CurrentFunction->EndOffset = m_Token.Offset + 1;
+				if (m_FunctionConsumer) {
+					// Names aren't kept either, they would grow with the file. Calls are still
+					// recognized by their '(', only the check for variables named like an
+					// earlier function is lost.
+					m_FunctionConsumer(*m_CurrentFunction);
+					delete m_CurrentFunction;
+				} else {
+					m_FunctionNames.insert(m_CurrentFunction->Name);
+					m_ProgramNode.Functions.push_back(m_CurrentFunction);
+				}
 				m_CurrentFunction = nullptr;
 				m_CurrentBlock = nullptr;
 				return true;
@@ -211,248 +173,356 @@ bool Parser::ParseFunction() {
 			}
 		}
 
-		// Parse Declaration
-		if(m_Token.Type == TokenType::Identifier && IsDataType(m_Token.Content)) {
-			if(ParseDeclaration())
-				continue;
+		if(m_Token.Type == TokenType::EndOfFile) {
+			ReportError(TokenType::CurlyClose);
+			return false;
 		}
 
-		// FunctionCalls
-		if(m_Token.Type == TokenType::Identifier && IsFunctionName(m_Token.Content)) {
-			if(ParseFunctionCall())
-				continue;
-		}
+		if(ParseStatement())
+			continue;
 
-		// If
-		if(m_Token.Type == TokenType::Identifier && m_Token.Content == "if") {
-			if(ParseIfExpression())
-				continue;
+		// Panic mode: skip to the next ';' or '}' and keep parsing the function
+		advance = !Synchronize();
+		if(m_Token.Type == TokenType::EndOfFile) {
+			// Don't report the same end of file twice
+			if(m_Diagnostics.back().Offset != m_Token.Offset)
+				ReportError(TokenType::CurlyClose);
+			return false;
 		}
+	}
+}
 
-		// While
-		if(m_Token.Type == TokenType::Identifier && m_Token.Content == "while") {
-			if(ParseWhileExpression())
-				continue;
-		}
+bool Parser::ParseStatement() {
+	size_t diagnostics = m_Diagnostics.size();
 
-		// Return
-		if(m_Token.Type == TokenType::Identifier && m_Token.Content == "return") {
-			if(ParseReturnExpression())
-				continue;
+	// Parse Declaration
+	if(m_Token.Type == TokenType::Identifier && IsDataType(m_Token.Content)) {
+		if(ParseDeclaration())
+			return true;
+	}
+
+	// FunctionCalls
+	else if(IsCallStart()) {
+		uint32_t offset = m_Token.Offset;
+		FunctionCallExpression* call = ParseFunctionCall();
+		if(call != nullptr) {
+			m_Token = m_Lexer.Consume();
+			if(Expect(TokenType::Semi)) {
+				m_CurrentBlock->Expressions.push_back({ExpressionType::FunctionCall, offset, call});
+				return true;
+			}
+			delete call;
 		}
+	}
 
-		// TODO: Binary and Unary Operations
+	// If
+	else if(m_Token.Type == TokenType::Identifier && m_Token.Content == "if") {
+		if(ParseIfExpression())
+			return true;
+	}
 
-		return false;
+	// Else
+	else if(m_Token.Type == TokenType::Identifier && m_Token.Content == "else") {
+		// TODO: Get Body Expression
+		m_CurrentBlock->Expressions.push_back({ExpressionType::Else, m_Token.Offset, new ElseExpression()});
+		return true;
 	}
+
+	// While
+	else if(m_Token.Type == TokenType::Identifier && m_Token.Content == "while") {
+		if(ParseWhileExpression())
+			return true;
+	}
+
+	// Return
+	else if(m_Token.Type == TokenType::Identifier && m_Token.Content == "return") {
+		if(ParseReturnExpression())
+			return true;
+	}
+
+	// TODO: Binary and Unary Operations
+
+	if(m_Diagnostics.size() == diagnostics)
+		ReportError(TokenType::Invalid);
+	return false;
 }
 
 bool Parser::ParseFunctionHeader() {
 	m_CurrentFunction = new FunctionNode();
 
 	// Type
-	if (!IsDataType(m_Token.Content))
+	if (!Expect(TokenType::Identifier))
+		return false;
+	if (!IsDataType(m_Token.Content)) {
+		ReportError(TokenType::Invalid);
 		return false;
+	}
 	m_CurrentFunction->ReturnType = m_Token.Content;
 
 	// Name
 	m_Token = m_Lexer.Consume();
-	if (m_Token.Type != TokenType::Identifier)
+	if (!Expect(TokenType::Identifier))
 		return false;
-	if (IsReserved(m_Token.Content))
+	if (IsReserved(m_Token.Content) || IsDataType(m_Token.Content)) {
+		ReportError(TokenType::Invalid);
 		return false;
+	}
 	m_CurrentFunction->Name = m_Token.Content;
+	m_CurrentFunction->Offset = m_Token.Offset;
 
 	// Parameters
 	m_Token = m_Lexer.Consume();
-	if (m_Token.Type != TokenType::ParenOpen)
+	if (!Expect(TokenType::ParenOpen))
 		return false;
-	while (true) {
-		m_Token = m_Lexer.Consume();
-		if (m_Token.Type != TokenType::Identifier || !IsDataType(m_Token.Content))
+	m_Token = m_Lexer.Consume();
+	while (m_Token.Type != TokenType::ParenClose) {
+		if (!Expect(TokenType::Identifier))
 			return false;
+		if (!IsDataType(m_Token.Content)) {
+			ReportError(TokenType::Invalid);
+			return false;
+		}
 		m_CurrentFunction->ParameterTypes.push_back(m_Token.Content);
 		m_Token = m_Lexer.Consume();
-		if (m_Token.Type != TokenType::Identifier || IsDataType(m_Token.Content) || IsReserved(m_Token.Content))
+		if (!Expect(TokenType::Identifier))
+			return false;
+		if (IsDataType(m_Token.Content) || IsReserved(m_Token.Content)) {
+			ReportError(TokenType::Invalid);
 			return false;
+		}
 		m_CurrentFunction->Parameters.push_back(m_Token.Content);
 		m_Token = m_Lexer.Consume();
-		if (m_Token.Type == TokenType::Comma)
+		if (m_Token.Type == TokenType::Comma) {
+			m_Token = m_Lexer.Consume();
 			continue;
-		if (m_Token.Type == TokenType::ParenClose)
-			break;
-		return false;
+		}
+		if (!Expect(TokenType::ParenClose))
+			return false;
 	}
 
 	// Block Open
 	m_Token = m_Lexer.Consume();
-	if(m_Token.Type != TokenType::CurlyOpen)
+	if(!Expect(TokenType::CurlyOpen))
 		return false;
-	m_Token = m_Lexer.Consume();
 	m_CurrentBlock = &m_CurrentFunction->Block;
 
 	return true;
 }
 
 bool Parser::ParseDeclaration() {
+	uint32_t offset = m_Token.Offset;
 	std::string type = m_Token.Content;
 	m_Token = m_Lexer.Consume();
-	if(m_Token.Type != TokenType::Identifier)
+	if(!Expect(TokenType::Identifier))
 		return false;
-	if(IsReserved(m_Token.Content) || IsDataType(m_Token.Content) || IsFunctionName(m_Token.Content))
+	if(IsReserved(m_Token.Content) || IsDataType(m_Token.Content) || IsFunctionName(m_Token.Content)) {
+		ReportError(TokenType::Invalid);
 		return false;
+	}
 	std::string name = m_Token.Content;
 	m_Token = m_Lexer.Consume();
 
 	if(m_Token.Type == TokenType::Semi) {
 		// Variable Declaration
 		DeclarationExpression* newExpression = new DeclarationExpression(type, name);
-		m_CurrentBlock->Expressions.push_back({ExpressionType::Declaration,newExpression});
+		m_CurrentBlock->Expressions.push_back({ExpressionType::Declaration, offset, newExpression});
 		return true;
 	}
 
 	if(m_Token.Type == TokenType::Equal) {
 		// Variable Initialization
+		m_Token = m_Lexer.Consume();
+		ValueExpression* value = GetValueExpression();
+		if(value == nullptr)
+			return false;
+		if(!Expect(TokenType::Semi)) {
+			delete value;
+			return false;
+		}
+
 		InitializationExpression* newExpression = new InitializationExpression();
 		newExpression->Identifier = name;
 		newExpression->Type = type;
+		newExpression->ValueExpression = new Expression{ExpressionType::Value, value->Offset, value};
 
-		// TODO: Get Value!
-
-		m_CurrentBlock->Expressions.push_back({ExpressionType::DeclarationWithAssignment,newExpression});
+		m_CurrentBlock->Expressions.push_back({ExpressionType::DeclarationWithAssignment, offset, newExpression});
 		return true;
 	}
 
+	ReportError(TokenType::Semi);
 	return false;
 }
 
 FunctionCallExpression* Parser::ParseFunctionCall() {
+	uint32_t offset = m_Token.Offset;
 	std::string name = m_Token.Content;
 	m_Token = m_Lexer.Consume();
-	if(m_Token.Type != TokenType::ParenOpen)
+	if(!Expect(TokenType::ParenOpen))
 		return nullptr;
 	FunctionCallExpression* newExpression = new FunctionCallExpression();
 	newExpression->Name = name;
+	newExpression->Offset = offset;
 
 	// Parameters
-	while (true) {
-		newExpression->Arguments.push_back(GetValueExpression());
-		if(m_Token.Type == TokenType::Comma)
+	m_Token = m_Lexer.Consume();
+	while (m_Token.Type != TokenType::ParenClose) {
+		ValueExpression* argument = GetValueExpression();
+		if(argument == nullptr) {
+			delete newExpression;
+			return nullptr;
+		}
+		newExpression->Arguments.push_back(argument);
+		if(m_Token.Type == TokenType::Comma) {
+			m_Token = m_Lexer.Consume();
 			continue;
-		if(m_Token.Type == TokenType::ParenClose)
-			break;
-		return nullptr;
+		}
+		if(!Expect(TokenType::ParenClose)) {
+			delete newExpression;
+			return nullptr;
+		}
 	}
 
 	return newExpression;
 }
 
 bool Parser::ParseIfExpression() {
-	IfExpression* newExpression = new IfExpression();
+	uint32_t offset = m_Token.Offset;
 
 	m_Token = m_Lexer.Consume();
-	if (m_Token.Type != TokenType::ParenOpen)
+	if (!Expect(TokenType::ParenOpen))
 		return false;
 
 	// TODO: Get Condition Expression
-	while (m_Token.Type != TokenType::ParenClose)
-		m_Token = m_Lexer.Consume();
+	if (!SkipParenthesized())
+		return false;
 
 	// TODO: Get Body Expression
 
-	m_CurrentBlock->Expressions.push_back({ExpressionType::If,newExpression});
-
-	// Else
-	if(m_Token.Type == TokenType::Identifier && m_Token.Content == "else") {
-		ElseExpression* newExpression = new ElseExpression();
-
-		// TODO: Get Body Expression
-
-		m_CurrentBlock->Expressions.push_back({ExpressionType::If,newExpression});
-	}
-
+	m_CurrentBlock->Expressions.push_back({ExpressionType::If, offset, new IfExpression()});
 	return true;
 }
 
 bool Parser::ParseWhileExpression() {
-	WhileExpression* newExpression = new WhileExpression();
+	uint32_t offset = m_Token.Offset;
 
 	m_Token = m_Lexer.Consume();
-	if (m_Token.Type != TokenType::ParenOpen)
+	if (!Expect(TokenType::ParenOpen))
 		return false;
 
 	// TODO: Get Condition Expression
-	while (m_Token.Type != TokenType::ParenClose)
-		m_Token = m_Lexer.Consume();
+	if (!SkipParenthesized())
+		return false;
 
-	m_Token = m_Lexer.Consume();
 	// TODO: Get Body Expression
 
-	m_CurrentBlock->Expressions.push_back({ExpressionType::While,newExpression});
+	m_CurrentBlock->Expressions.push_back({ExpressionType::While, offset, new WhileExpression()});
 	return true;
 }
 
 bool Parser::ParseReturnExpression() {
-	ReturnExpression* newExpression = new ReturnExpression();
+	uint32_t offset = m_Token.Offset;
+	ValueExpression* value = nullptr;
 
 	m_Token = m_Lexer.Consume();
 	if(m_Token.Type != TokenType::Semi) {
-		newExpression->Value = GetValueExpression();
+		value = GetValueExpression();
+		if(value == nullptr)
+			return false;
+		if(!Expect(TokenType::Semi)) {
+			delete value;
+			return false;
+		}
 	}
 
-	m_CurrentBlock->Expressions.push_back({ExpressionType::Return,newExpression});
+	ReturnExpression* newExpression = new ReturnExpression();
+	newExpression->Value = value;
+	m_CurrentBlock->Expressions.push_back({ExpressionType::Return, offset, newExpression});
 	return true;
 }
 
 ValueExpression *Parser::GetValueExpression() {
-	m_Token = m_Lexer.Consume();
+	ValueExpression* valueExpr = nullptr;
 
-	if (m_Token.Type == TokenType::Semi || m_Token.Type == TokenType::Invalid)
-		return nullptr;
-
-	m_Token = m_Lexer.Consume();
-	Token t2 = m_Token;
-
-	if (m_Token.Type == TokenType::Identifier && !IsOperator(m_Lexer.Peek().Content) &&
-			IsDelimiter(m_Lexer.Peek().Content)) {
+	if (IsCallStart()) {
 		// Functional
-		if (IsFunctionName(m_Token.Content)) {
-			ValueExpression* valueExpr = new ValueExpression();
-			valueExpr->Type = ValueExpressionType::FunctionCall;
-			valueExpr->FunctionCall = ParseFunctionCall();
-			return valueExpr;
+		uint32_t offset = m_Token.Offset;
+		// Calls nest through recursion, bound it so hostile input can't overflow the stack
+		if (m_CallDepth >= s_MaxCallDepth) {
+			ReportError(TokenType::Invalid);
+			return nullptr;
 		}
+		m_CallDepth++;
+		FunctionCallExpression* call = ParseFunctionCall();
+		m_CallDepth--;
+		if (call == nullptr)
+			return nullptr;
+		valueExpr = new ValueExpression();
+		valueExpr->Offset = offset;
+		valueExpr->Type = ValueExpressionType::FunctionCall;
+		valueExpr->FunctionCall = call;
+	} else if (m_Token.Type == TokenType::Identifier && !IsReserved(m_Token.Content) && !IsDataType(m_Token.Content)) {
 		// Variable
-		ValueExpression* valueExpr = new ValueExpression();
+		valueExpr = new ValueExpression();
+		valueExpr->Offset = m_Token.Offset;
 		valueExpr->Type = ValueExpressionType::Variable;
 		valueExpr->VariableName = m_Token.Content;
-		return valueExpr;
 	} else if (m_Token.Type == TokenType::IntLit) {
-		ValueExpression* valueExpr = new ValueExpression();
+		long value = 0;
+		if (!ParseIntLiteral(m_Token.Content, value)) {
+			ReportError(TokenType::Invalid);
+			return nullptr;
+		}
+		valueExpr = new ValueExpression();
+		valueExpr->Offset = m_Token.Offset;
 		valueExpr->Type = ValueExpressionType::IntLiteral;
-		valueExpr->ValueLiteral = std::stol(m_Token.Content);
-		return valueExpr;
+		valueExpr->ValueLiteral = value;
 	} /* else if (m_Token.Type == TokenType::FloatLit) {
-		ValueExpression* valueExpr = new ValueExpression();
+		valueExpr = new ValueExpression();
+		valueExpr->Offset = m_Token.Offset;
 		valueExpr->Type = ValueExpressionType::FloatLiteral;
 		valueExpr->FloatingLiteral = std::stod(m_Token.Content);
-		return valueExpr;
 	} */ else if (m_Token.Type == TokenType::StringLit) {
-		ValueExpression* valueExpr = new ValueExpression();
+		valueExpr = new ValueExpression();
+		valueExpr->Offset = m_Token.Offset;
 		valueExpr->Type = ValueExpressionType::StringLiteral;
 		valueExpr->StringLiteral = m_Token.Content;
-		return valueExpr;
 	} else {
-		// Handle other types of expressions (Unary/Binary operations, etc.)
-		// Logic to parse and handle unary/binary operations
-		// Example:
-		// Parse unary or binary operations
-		// Set the valueExpr fields accordingly
-		// This would involve checking the current token and performing appropriate parsing for operations
+		// TODO: Unary and Binary operations
+		ReportError(TokenType::Invalid);
+		return nullptr;
+	}
+
+	m_Token = m_Lexer.Consume();
+	return valueExpr;
+}
+
+bool Parser::SkipParenthesized() {
+	int depth = 1;
+	while (true) {
+		m_Token = m_Lexer.Consume();
+		if (m_Token.Type == TokenType::ParenOpen)
+			depth++;
+		else if (m_Token.Type == TokenType::ParenClose && --depth == 0)
+			return true;
+		else if (m_Token.Type == TokenType::EndOfFile || m_Token.Type == TokenType::CurlyOpen || m_Token.Type == TokenType::CurlyClose
+				|| m_Token.Type == TokenType::Semi) {
+			// Never run past the statement, recovery takes it from here
+			ReportError(TokenType::ParenClose);
+			return false;
+		}
 	}
+}
 
-	// Return null if expression type cannot be determined or handled
-	return nullptr;
+bool Parser::ParseIntLiteral(const std::string& t, long& value) {
+	unsigned long result = 0;
+	for (char c : t) {
+		unsigned digit = (unsigned)(c - '0');
+		if (result > ((unsigned long)LONG_MAX - digit) / 10)
+			return false;
+		result = result * 10 + digit;
+	}
+	value = (long)result;
+	return true;
 }
 
 bool Parser::IsOperator(const std::string &t) {
@@ -477,7 +547,12 @@ ProgramNode::~ProgramNode() {
 }
 
 BlockExpression::~BlockExpression() {
-	for(auto& exp : Expressions){
+	// Nested blocks are flattened into this list before they are deleted, so
+	// destroying deeply nested blocks does not recurse
+	std::vector<Expression> pending = std::move(Expressions);
+	while(!pending.empty()) {
+		Expression exp = pending.back();
+		pending.pop_back();
 		switch (exp.Type) {
 			case ExpressionType::Declaration:
 				delete reinterpret_cast<DeclarationExpression*>(exp.Data);
@@ -488,9 +563,13 @@ BlockExpression::~BlockExpression() {
 			case ExpressionType::DeclarationWithAssignment:
 				delete reinterpret_cast<InitializationExpression*>(exp.Data);
 				break;
-			case ExpressionType::Block:
-				delete reinterpret_cast<BlockExpression*>(exp.Data);
+			case ExpressionType::Block: {
+				BlockExpression* block = reinterpret_cast<BlockExpression*>(exp.Data);
+				pending.insert(pending.end(), block->Expressions.begin(), block->Expressions.end());
+				block->Expressions.clear();
+				delete block;
 				break;
+			}
 			case ExpressionType::FunctionCall:
 				delete reinterpret_cast<FunctionCallExpression*>(exp.Data);
 				break;
@@ -523,3 +602,20 @@ ValueExpression::~ValueExpression() {
 	if(FunctionCall != nullptr)
 		delete FunctionCall;
 }
+
+FunctionCallExpression::~FunctionCallExpression() {
+	for(auto* argument : Arguments)
+		delete argument;
+}
+
+InitializationExpression::~InitializationExpression() {
+	// The parser only stores value expressions here
+	if(ValueExpression != nullptr) {
+		delete reinterpret_cast<::ValueExpression*>(ValueExpression->Data);
+		delete ValueExpression;
+	}
+}
+
+ReturnExpression::~ReturnExpression() {
+	delete Value;
+}
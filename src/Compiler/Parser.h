@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+#include <unordered_set>
 #include <vector>
 #include "Lexer.h"
 #include "ErrorHandling/CompilerResult.h"
@@ -77,13 +79,14 @@ struct DeclarationExpression {
 
 struct AssignmentExpression {
     std::string Identifier;
-    Expression* ValueExpression;
+    Expression* ValueExpression = nullptr;
 };
 
 struct InitializationExpression {
+	~InitializationExpression();
 	std::string Type;
     std::string Identifier;
-    Expression* ValueExpression;
+    Expression* ValueExpression = nullptr;
 };
 
 struct BlockExpression {
@@ -99,19 +102,22 @@ struct BlockExpression {
 struct ValueExpression;
 
 struct FunctionCallExpression {
+    ~FunctionCallExpression();
     std::string Name;
+    uint32_t Offset = 0;
     std::vector<ValueExpression*> Arguments;
 };
 
 struct ValueExpression {
 	~ValueExpression();
 	ValueExpressionType Type;
+	uint32_t Offset = 0;
 	std::string DataType;
 	std::string StringLiteral;
 	std::string VariableName;
-	long ValueLiteral;
-	double FloatingLiteral;
-	FunctionCallExpression* FunctionCall;
+	long ValueLiteral = 0;
+	double FloatingLiteral = 0.0;
+	FunctionCallExpression* FunctionCall = nullptr;
 };
 
 struct UnaryOperationExpression {
@@ -128,30 +134,34 @@ struct BinaryOperationExpression {
 };
 
 struct ReturnExpression {
-    ValueExpression* Value;
+    ~ReturnExpression();
+    ValueExpression* Value = nullptr;
 };
 
 struct WhileExpression {
-    Expression* ConditionExpression;
-    Expression* BodyExpression;
+    Expression* ConditionExpression = nullptr;
+    Expression* BodyExpression = nullptr;
 };
 
 struct IfExpression {
-    Expression* ConditionExpression;
-    Expression* BodyExpression;
+    Expression* ConditionExpression = nullptr;
+    Expression* BodyExpression = nullptr;
 };
 
 struct ElseExpression {
-    Expression* BodyExpression;
+    Expression* BodyExpression = nullptr;
 };
 
 struct Expression {
     ExpressionType Type;
+    uint32_t Offset; // Offset of the first token, fits next to Type without growing the node
     void* Data;
 };
 
 struct FunctionNode {
     std::string Name;
+    uint32_t Offset = 0;
+    uint32_t EndOffset = 0; // One past the closing brace
     std::string ReturnType;
     std::vector<std::string> ParameterTypes;
     std::vector<std::string> Parameters;
@@ -163,13 +173,20 @@ struct ProgramNode {
     std::vector<FunctionNode*> Functions;
 };
 
+// Receives every function as soon as its closing brace has been parsed
+using FunctionConsumer = std::function<void(const FunctionNode& function)>;
+
 class Parser {
 public:
 	explicit Parser(Lexer& lexer);
     CompilerResult Parse();
-	void PrintProgramTree();
+	const ProgramNode& GetProgram() const { return m_ProgramNode; }
+	// Streaming: functions go to the consumer and are freed right after instead
+	// of being kept in the program, so memory is bounded by the largest function
+	void SetFunctionConsumer(FunctionConsumer consumer) { m_FunctionConsumer = std::move(consumer); }
 private:
 	bool ParseFunction();
+	bool ParseStatement();
 	bool ParseFunctionHeader();
 	bool ParseDeclaration();
 	FunctionCallExpression* ParseFunctionCall();
@@ -178,19 +195,29 @@ private:
 	bool ParseReturnExpression();
 	ValueExpression* GetValueExpression();
 
+	void ReportError(TokenType expected);
+	bool Expect(TokenType type);
+	bool Synchronize();
+	bool SkipParenthesized();
+
 
 	static bool IsReserved(const std::string& t);
 	static bool IsDataType(const std::string& t);
+	static bool ParseIntLiteral(const std::string& t, long& value);
 	bool IsFunctionName(const std::string& t);
+	bool IsCallStart();
 	bool IsOperator(const std::string& t);
 	bool IsDelimiter(const std::string& t);
 
-	void PrintBlockExpression(BlockExpression* expression, int indent);
-	void PrintExpression(Expression* expression, int indent);
-
 	Lexer& m_Lexer;
 	Token m_Token;
     ProgramNode m_ProgramNode;
 	FunctionNode* m_CurrentFunction = nullptr;
 	BlockExpression* m_CurrentBlock = nullptr;
+	std::vector<Diagnostic> m_Diagnostics;
+	std::unordered_set<std::string> m_FunctionNames;
+	FunctionConsumer m_FunctionConsumer;
+	int m_CallDepth = 0;
+
+	static constexpr int s_MaxCallDepth = 256;
 };
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "SemanticAnalyzer.h"
+#include "AstVisitor.h"
+
+struct ScopeEntry {
+	uint32_t Name; // Id from the analyzer's name table
+	DataType Type;
+	// The declaration of the same name this one hides, s_NoSlot if none
+	uint32_t Shadowed;
+};
+
+// Checks one function. Symbols live on a single flat stack, a scope is the
+// index where it starts. Names get their ids from the analyzer, which keeps
+// them across functions, and the innermost declaration of every id is kept
+// alongside, so lookups are constant time. Every entry remembers the one it
+// shadows so leaving a scope can restore the outer names, after the function
+// body all ids are undeclared again. Value types go on a second stack in
+// post-order, the node consuming a value pops it.
+class FunctionChecker : public AstVisitor<FunctionChecker> {
+public:
+	FunctionChecker(const SemanticAnalyzer& analyzer, std::unordered_map<std::string, uint32_t>& nameIds,
+		std::vector<uint32_t>& innermost, const FunctionNode& function, FunctionSemantics& result)
+		: m_Analyzer(analyzer), m_NameIds(nameIds), m_Innermost(innermost), m_Function(function), m_Result(result) {}
+
+	bool EnterFunction(const FunctionNode& function) {
+		m_ReturnType = SemanticAnalyzer::ParseType(function.ReturnType);
+		// Parameters share the scope of the function body
+		m_ScopeStarts.push_back(0);
+		for (size_t i = 0; i < function.Parameters.size(); i++) {
+			DataType type = SemanticAnalyzer::ParseType(function.ParameterTypes[i]);
+			if (type == DataType::Void) {
+				Report(ResultType::TypeMismatch, function.Offset, "parameter " + function.Parameters[i] + " can't be void");
+				type = DataType::Unknown;
+			}
+			Declare(function.Parameters[i], type, function.Offset);
+		}
+		return true;
+	}
+
+	bool EnterBlock(const BlockExpression& block, uint32_t /*offset*/) {
+		if (&block != &m_Function.Block)
+			m_ScopeStarts.push_back((uint32_t)m_Symbols.size());
+		return true;
+	}
+
+	// The function body also closes the parameter scope
+	void LeaveBlock(const BlockExpression& /*block*/, uint32_t /*offset*/) {
+		while (m_Symbols.size() > m_ScopeStarts.back()) {
+			m_Innermost[m_Symbols.back().Name] = m_Symbols.back().Shadowed;
+			m_Symbols.pop_back();
+		}
+		m_ScopeStarts.pop_back();
+	}
+
+	bool EnterDeclaration(const DeclarationExpression& declaration, uint32_t offset) {
+		Record(offset, Declare(declaration.Identifier, GetVariableType(declaration.Type, declaration.Identifier, offset), offset));
+		return true;
+	}
+
+	void LeaveInitialization(const InitializationExpression& initialization, uint32_t offset) {
+		DataType type = GetVariableType(initialization.Type, initialization.Identifier, offset);
+		CheckValue(type, initialization.ValueExpression->Offset, "initialize " + initialization.Identifier);
+		// Declared after the initializer, it can't refer to itself
+		Record(offset, Declare(initialization.Identifier, type, offset));
+	}
+
+	void LeaveAssignment(const AssignmentExpression& assignment, uint32_t offset) {
+		DataType type = Resolve(assignment.Identifier, offset);
+		if (assignment.ValueExpression != nullptr)
+			CheckValue(type, assignment.ValueExpression->Offset, "assign " + assignment.Identifier);
+	}
+
+	bool EnterValue(const ValueExpression& value, uint32_t offset) {
+		switch (value.Type) {
+			case ValueExpressionType::Variable: m_Values.push_back(Resolve(value.VariableName, offset)); break;
+			case ValueExpressionType::IntLiteral: m_Values.push_back(DataType::Int); break;
+			case ValueExpressionType::StringLiteral: m_Values.push_back(DataType::String); break;
+			default: m_Values.push_back(DataType::Unknown); break;
+		}
+		return true;
+	}
+
+	void LeaveCall(const FunctionCallExpression& call, uint32_t offset) {
+		size_t count = call.Arguments.size();
+		size_t first = m_Values.size() - count;
+
+		CalleeSignature callee;
+		bool found = m_Analyzer.FindCallee(call.Name, callee);
+		if (!found) {
+			Report(ResultType::UnresolvedSymbol, offset, "no function named " + call.Name);
+		} else if (callee.ParameterTypes.size() != count) {
+			Report(ResultType::InvalidCall, offset, call.Name + " takes " + std::to_string(callee.ParameterTypes.size()) +
+				" argument(s), got " + std::to_string(count));
+		} else {
+			for (size_t i = 0; i < count; i++) {
+				CheckConversion(m_Values[first + i], callee.ParameterTypes[i], call.Arguments[i]->Offset,
+					"pass as argument " + std::to_string(i + 1) + " of " + call.Name);
+			}
+		}
+
+		if (m_Dependencies.insert(call.Name).second) {
+			m_Result.Dependencies.push_back(call.Name);
+			if (found && !m_Analyzer.Defines(call.Name))
+				m_Result.Imports.push_back(call.Name);
+		}
+
+		m_Values.resize(first);
+		m_Values.push_back(callee.ReturnType);
+	}
+
+	void LeaveReturn(const ReturnExpression& node, uint32_t offset) {
+		if (node.Value == nullptr) {
+			if (m_ReturnType != DataType::Void && m_ReturnType != DataType::Unknown)
+				Report(ResultType::TypeMismatch, offset, m_Function.Name + " must return " + SemanticAnalyzer::TypeToString(m_ReturnType));
+			return;
+		}
+
+		if (m_ReturnType == DataType::Void) {
+			m_Values.pop_back();
+			Report(ResultType::TypeMismatch, node.Value->Offset, m_Function.Name + " returns void, it can't return a value");
+			return;
+		}
+		CheckValue(m_ReturnType, node.Value->Offset, "return from " + m_Function.Name);
+	}
+
+	// The condition is the first child, its type is the first value pushed after
+	// entering. The parser does not keep conditions yet, they are checked once it does.
+	bool EnterWhile(const WhileExpression& /*node*/, uint32_t /*offset*/) { return EnterCondition(); }
+	void LeaveWhile(const WhileExpression& node, uint32_t /*offset*/) { LeaveCondition(node.ConditionExpression); }
+	bool EnterIf(const IfExpression& /*node*/, uint32_t /*offset*/) { return EnterCondition(); }
+	void LeaveIf(const IfExpression& node, uint32_t /*offset*/) { LeaveCondition(node.ConditionExpression); }
+private:
+	DataType GetVariableType(const std::string& typeName, const std::string& name, uint32_t offset) {
+		DataType type = SemanticAnalyzer::ParseType(typeName);
+		if (type != DataType::Void)
+			return type;
+		Report(ResultType::TypeMismatch, offset, "variable " + name + " can't be void");
+		return DataType::Unknown;
+	}
+
+	// Returns the slot of the new local
+	uint32_t Declare(const std::string& name, DataType type, uint32_t offset) {
+		uint32_t slot = (uint32_t)m_Symbols.size();
+		uint32_t id = m_NameIds.emplace(name, (uint32_t)m_NameIds.size()).first->second;
+		if (id >= m_Innermost.size())
+			m_Innermost.resize((size_t)id + 1, FunctionSemantics::s_NoSlot);
+
+		uint32_t shadowed = m_Innermost[id];
+		if (shadowed != FunctionSemantics::s_NoSlot && shadowed >= m_ScopeStarts.back())
+			Report(ResultType::Redeclaration, offset, name + " is already declared in this scope");
+		m_Innermost[id] = slot;
+
+		m_Symbols.push_back({id, type, shadowed});
+		m_Result.SlotCount = std::max(m_Result.SlotCount, (uint32_t)m_Symbols.size());
+		return slot;
+	}
+
+	DataType Resolve(const std::string& name, uint32_t offset) {
+		// A name without an id was never declared
+		auto id = m_NameIds.find(name);
+		uint32_t slot = id == m_NameIds.end() ? FunctionSemantics::s_NoSlot : m_Innermost[id->second];
+		if (slot != FunctionSemantics::s_NoSlot) {
+			Record(offset, slot);
+			return m_Symbols[slot].Type;
+		}
+
+		Report(ResultType::UnresolvedSymbol, offset, "no variable named " + name);
+		return DataType::Unknown;
+	}
+
+	// Parameters are implicitly the first slots, everything else is looked up by
+	// the offset of its node
+	void Record(uint32_t offset, uint32_t slot) {
+		m_Result.Slots[offset - m_Function.Offset] = slot;
+	}
+
+	// Pops the value on top of the type stack and checks it against the target
+	void CheckValue(DataType target, uint32_t offset, const std::string& context) {
+		DataType type = m_Values.back();
+		m_Values.pop_back();
+		CheckConversion(type, target, offset, context);
+	}
+
+	void CheckConversion(DataType from, DataType to, uint32_t offset, const std::string& context) {
+		if (from == DataType::Void)
+			Report(ResultType::TypeMismatch, offset, "can't " + context + " with the result of a void function");
+		else if (!SemanticAnalyzer::IsConvertible(from, to))
+			Report(ResultType::TypeMismatch, offset, std::string("can't ") + context + ", " + SemanticAnalyzer::TypeToString(from) +
+				" is not convertible to " + SemanticAnalyzer::TypeToString(to));
+	}
+
+	bool EnterCondition() {
+		m_ConditionStarts.push_back(m_Values.size());
+		return true;
+	}
+
+	void LeaveCondition(const Expression* condition) {
+		size_t start = m_ConditionStarts.back();
+		m_ConditionStarts.pop_back();
+		if (condition == nullptr || m_Values.size() <= start)
+			return;
+
+		DataType type = m_Values[start];
+		m_Values.resize(start);
+		if (type != DataType::Int && type != DataType::Bool && type != DataType::Unknown)
+			Report(ResultType::TypeMismatch, condition->Offset, std::string("condition must be int or bool, got ") +
+				SemanticAnalyzer::TypeToString(type));
+	}
+
+	void Report(ResultType kind, uint32_t offset, std::string message) {
+		m_Result.Diagnostics.push_back({kind, offset - m_Function.Offset, TokenType::Invalid, TokenType::Invalid, std::move(message)});
+	}
+
+	const SemanticAnalyzer& m_Analyzer;
+	std::unordered_map<std::string, uint32_t>& m_NameIds;
+	std::vector<uint32_t>& m_Innermost; // Slot per name id, s_NoSlot if undeclared
+	const FunctionNode& m_Function;
+	FunctionSemantics& m_Result;
+	DataType m_ReturnType = DataType::Unknown;
+	std::vector<ScopeEntry> m_Symbols;
+	std::vector<uint32_t> m_ScopeStarts;
+	std::vector<DataType> m_Values;
+	std::vector<size_t> m_ConditionStarts;
+	std::unordered_set<std::string> m_Dependencies;
+};
+
+const FunctionSemantics* SemanticCache::Find(const std::string& text) const {
+	auto it = m_Entries.find(text);
+	return it == m_Entries.end() ? nullptr : &it->second;
+}
+
+void SemanticCache::Insert(const std::string& text, const FunctionSemantics& semantics) {
+	if (m_Entries.size() >= s_MaxEntries)
+		m_Entries.clear();
+	m_Entries[text] = semantics;
+}
+
+SemanticAnalyzer::SemanticAnalyzer(const ProgramNode& program, const std::string& source, ExternalLookup external,
+	SemanticCache* cache) : m_Program(program), m_Source(source), m_External(std::move(external)), m_Cache(cache) {
+	std::unordered_set<std::string> reported;
+	for (const FunctionNode* function : m_Program.Functions) {
+		if (!m_Functions.emplace(function->Name, function).second && reported.insert(function->Name).second)
+			m_Redeclarations.push_back({ResultType::Redeclaration, function->Offset, TokenType::Invalid, TokenType::Invalid,
+				"function " + function->Name + " is already defined"});
+	}
+}
+
+FunctionSemantics SemanticAnalyzer::Analyze(const FunctionNode& function) {
+	// The return type is left of the name offset, the rest of the header and the
+	// body follow it
+	std::string key;
+	if (m_Cache != nullptr) {
+		key = function.ReturnType + ' ' + m_Source.substr(function.Offset, function.EndOffset - function.Offset);
+		const FunctionSemantics* cached = m_Cache->Find(key);
+		if (cached != nullptr && IsValid(*cached))
+			return *cached;
+	}
+
+	FunctionSemantics result;
+	FunctionChecker checker(*this, m_NameIds, m_Innermost, function, result);
+	checker.Visit(function);
+
+	for (const std::string& callee : result.Dependencies)
+		result.DependencyHashes.push_back(HashSignature(callee));
+	if (m_Cache != nullptr)
+		m_Cache->Insert(key, result);
+	return result;
+}
+
+bool SemanticAnalyzer::FindCallee(const std::string& name, CalleeSignature& signature) const {
+	auto it = m_Functions.find(name);
+	if (it == m_Functions.end())
+		return m_External != nullptr && m_External(name, signature);
+
+	const FunctionNode& function = *it->second;
+	signature.ReturnType = ParseType(function.ReturnType);
+	signature.ParameterTypes.clear();
+	for (const std::string& type : function.ParameterTypes)
+		signature.ParameterTypes.push_back(ParseType(type));
+	return true;
+}
+
+DataType SemanticAnalyzer::ParseType(const std::string& name) {
+	if (name == "int")
+		return DataType::Int;
+	if (name == "bool")
+		return DataType::Bool;
+	if (name == "char")
+		return DataType::Char;
+	if (name == "void")
+		return DataType::Void;
+	return DataType::Unknown;
+}
+
+const char* SemanticAnalyzer::TypeToString(DataType type) {
+	switch (type) {
+		case DataType::Void: return "void";
+		case DataType::Int: return "int";
+		case DataType::Bool: return "bool";
+		case DataType::Char: return "char";
+		case DataType::String: return "string";
+		default: return "unknown";
+	}
+}
+
+bool SemanticAnalyzer::IsConvertible(DataType from, DataType to) {
+	// Unknown was already reported where it came from
+	if (from == DataType::Unknown || to == DataType::Unknown)
+		return true;
+	if (from == DataType::Void || to == DataType::Void)
+		return false;
+	if (to == DataType::Char)
+		return from == DataType::Char || from == DataType::String;
+	if (from == DataType::Char || from == DataType::String)
+		return from == to;
+	return true;
+}
+
+uint64_t SemanticAnalyzer::HashSignature(const std::string& name) const {
+	CalleeSignature signature;
+	if (!FindCallee(name, signature))
+		return 0;
+
+	// FNV-1a over where the callee is defined, the return and parameter types.
+	// A callee moving to or from an import changes how its calls are lowered.
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&](DataType type) {
+		hash ^= (uint8_t)type + 1;
+		hash *= 1099511628211ull;
+	};
+	hash ^= Defines(name) ? 0 : 0x80;
+	hash *= 1099511628211ull;
+	add(signature.ReturnType);
+	for (DataType type : signature.ParameterTypes)
+		add(type);
+	return hash;
+}
+
+bool SemanticAnalyzer::IsValid(const FunctionSemantics& semantics) const {
+	for (size_t i = 0; i < semantics.Dependencies.size(); i++) {
+		if (HashSignature(semantics.Dependencies[i]) != semantics.DependencyHashes[i])
+			return false;
+	}
+	return true;
+}
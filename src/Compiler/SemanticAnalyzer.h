@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Parser.h"
+#include "ErrorHandling/CompilerResult.h"
+
+enum class DataType : uint8_t {
+	Unknown, // Unresolved or already reported, never causes further errors
+	Void,
+	Int,
+	Bool,
+	Char,
+	String // Only string literals, no variable can hold one yet
+};
+
+struct CalleeSignature {
+	DataType ReturnType = DataType::Unknown;
+	std::vector<DataType> ParameterTypes;
+};
+
+// Looks up functions the program does not define, false if there is none
+using ExternalLookup = std::function<bool(const std::string& name, CalleeSignature& signature)>;
+
+struct FunctionSemantics {
+	static constexpr uint32_t s_NoSlot = UINT32_MAX;
+
+	// Slot of every declaration, assignment target and variable use, keyed by the
+	// offset of its node relative to FunctionNode::Offset. Parameters are not
+	// listed, they always take the slots 0 to n - 1. Slots are positions in the
+	// scope stack, so locals of sibling blocks share them.
+	std::unordered_map<uint32_t, uint32_t> Slots;
+	uint32_t SlotCount = 0;
+	// Offsets are relative to FunctionNode::Offset so the result survives the
+	// function moving within the file
+	std::vector<Diagnostic> Diagnostics;
+	// Callees and a hash of their signature at analysis time, a cached result is
+	// only valid while all of them are unchanged
+	std::vector<std::string> Dependencies;
+	std::vector<uint64_t> DependencyHashes;
+	// The callees only the external lookup resolved, code generation leaves
+	// them to be linked by name
+	std::vector<std::string> Imports;
+
+	// s_NoSlot where the name is undeclared
+	uint32_t GetSlot(const FunctionNode& function, uint32_t offset) const {
+		auto it = Slots.find(offset - function.Offset);
+		return it == Slots.end() ? s_NoSlot : it->second;
+	}
+};
+
+// Remembers results per function across compiles, keyed by the source text of
+// the function. Long running modes (server, watch) keep one and only functions
+// whose text or callee signatures changed are analyzed again.
+class SemanticCache {
+public:
+	const FunctionSemantics* Find(const std::string& text) const;
+	void Insert(const std::string& text, const FunctionSemantics& semantics);
+	size_t GetSize() const { return m_Entries.size(); }
+private:
+	// Dropped as a whole once full, rebuilding is cheap
+	static constexpr size_t s_MaxEntries = 1 << 16;
+
+	std::unordered_map<std::string, FunctionSemantics> m_Entries;
+};
+
+// Resolves every variable use to its declaration and checks the int, bool,
+// char and void types of initializations, assignments, calls, conditions and
+// returns. Scope state is reused from one function to the next, so an analyzer
+// checks one function at a time.
+class SemanticAnalyzer {
+public:
+	SemanticAnalyzer(const ProgramNode& program, const std::string& source, ExternalLookup external = nullptr,
+		SemanticCache* cache = nullptr);
+
+	FunctionSemantics Analyze(const FunctionNode& function);
+	// One for every function name the program defines more than once, at its
+	// second definition. Offsets are absolute.
+	const std::vector<Diagnostic>& GetRedeclarations() const { return m_Redeclarations; }
+
+	// False if the program does not define the function and the lookup can't find it
+	bool FindCallee(const std::string& name, CalleeSignature& signature) const;
+	bool Defines(const std::string& name) const { return m_Functions.count(name) != 0; }
+
+	static DataType ParseType(const std::string& name);
+	static const char* TypeToString(DataType type);
+	// Int and bool convert into each other, char holds text and only takes chars
+	// and string literals. Nothing converts to or from void.
+	static bool IsConvertible(DataType from, DataType to);
+private:
+	uint64_t HashSignature(const std::string& name) const;
+	bool IsValid(const FunctionSemantics& semantics) const;
+
+	const ProgramNode& m_Program;
+	const std::string& m_Source;
+	ExternalLookup m_External;
+	SemanticCache* m_Cache;
+	std::unordered_map<std::string, const FunctionNode*> m_Functions;
+	std::vector<Diagnostic> m_Redeclarations;
+	// Variable names of all functions analyzed so far and the innermost slot of
+	// each, s_NoSlot between functions
+	std::unordered_map<std::string, uint32_t> m_NameIds;
+	std::vector<uint32_t> m_Innermost;
+};
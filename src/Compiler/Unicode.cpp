@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstring>
+#include "Unicode.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CSC_UNICODE_SSE2
+	#include <emmintrin.h>
+#endif
+
+// Moves pos past the run of ASCII bytes starting at it
+static size_t SkipAscii(const uint8_t* data, size_t pos, size_t size) {
+#ifdef CSC_UNICODE_SSE2
+	// A byte is ASCII if its high bit is clear, movemask collects the high bits
+	for (; pos + 16 <= size; pos += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		if (_mm_movemask_epi8(chunk) != 0)
+			break;
+	}
+#else
+	for (; pos + 8 <= size; pos += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + pos, 8);
+		if ((word & 0x8080808080808080ull) != 0)
+			break;
+	}
+#endif
+	while (pos < size && data[pos] < 0x80)
+		pos++;
+	return pos;
+}
+
+// Length of the well formed sequence at pos, 0 if it is malformed
+static size_t SequenceLength(const uint8_t* data, size_t pos, size_t size) {
+	uint8_t lead = data[pos];
+	size_t length;
+	uint8_t min = 0x80, max = 0xBF; // Allowed range of the second byte
+
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+	} else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		if (lead == 0xE0)
+			min = 0xA0; // Overlong
+		else if (lead == 0xED)
+			max = 0x9F; // Surrogates
+	} else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		if (lead == 0xF0)
+			min = 0x90; // Overlong
+		else if (lead == 0xF4)
+			max = 0x8F; // Above U+10FFFF
+	} else {
+		return 0;
+	}
+
+	if (size - pos < length)
+		return 0;
+	if (data[pos + 1] < min || data[pos + 1] > max)
+		return 0;
+	for (size_t i = 2; i < length; i++) {
+		if ((data[pos + i] & 0xC0) != 0x80)
+			return 0;
+	}
+	return length;
+}
+
+size_t Unicode::FindInvalidUtf8(const char* data, size_t size) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	size_t pos = 0;
+	while (true) {
+		pos = SkipAscii(bytes, pos, size);
+		if (pos >= size)
+			return size;
+
+		size_t length = SequenceLength(bytes, pos, size);
+		if (length == 0)
+			return pos;
+		pos += length;
+	}
+}
+
+uint32_t Unicode::DecodeUtf8(const std::string& text, size_t& pos) {
+	uint8_t lead = (uint8_t)text[pos++];
+	if (lead < 0x80)
+		return lead;
+
+	size_t continuation = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : 1;
+	uint32_t codePoint = lead & (0x3F >> continuation);
+	for (size_t i = 0; i < continuation; i++)
+		codePoint = (codePoint << 6) | ((uint8_t)text[pos++] & 0x3F);
+	return codePoint;
+}
+
+bool Unicode::InRanges(const CodePointRange* ranges, size_t count, uint32_t codePoint) {
+	const CodePointRange* end = ranges + count;
+	const CodePointRange* it = std::upper_bound(ranges, end, codePoint,
+		[](uint32_t value, const CodePointRange& range) { return value < range.First; });
+	return it != ranges && codePoint <= (it - 1)->Last;
+}
+
+bool Unicode::IsXidStart(uint32_t codePoint) {
+	return InRanges(s_XidStartRanges, s_XidStartRangeCount, codePoint);
+}
+
+bool Unicode::IsXidContinue(uint32_t codePoint) {
+	return InRanges(s_XidContinueRanges, s_XidContinueRangeCount, codePoint);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// UTF-8 and identifier classification for the lexer. Sources are validated once
+// when the lexer is created, so decoding afterwards can assume well formed input.
+class Unicode {
+public:
+	// Offset of the first byte that does not belong to a well formed UTF-8
+	// sequence, or size if the whole buffer is valid. Overlong forms, surrogates
+	// and code points above U+10FFFF are rejected.
+	static size_t FindInvalidUtf8(const char* data, size_t size);
+
+	// Decodes the code point starting at pos and moves pos past it. Only valid on
+	// validated input.
+	static uint32_t DecodeUtf8(const std::string& text, size_t& pos);
+
+	// Unicode identifier properties (UAX #31) for code points above ASCII
+	static bool IsXidStart(uint32_t codePoint);
+	static bool IsXidContinue(uint32_t codePoint);
+private:
+	struct CodePointRange {
+		uint32_t First;
+		uint32_t Last;
+	};
+
+	static bool InRanges(const CodePointRange* ranges, size_t count, uint32_t codePoint);
+
+	// Generated, see UnicodeTables.cpp
+	static const CodePointRange s_XidStartRanges[];
+	static const size_t s_XidStartRangeCount;
+	static const CodePointRange s_XidContinueRanges[];
+	static const size_t s_XidContinueRangeCount;
+};
@@ -0,0 +1,180 @@
+#include <cstdio>
+#include "CompileUnit.h"
+#include "Compiler/CodeGenerator.h"
+#include "IO/File.h"
+
+CompileUnit::CompileUnit(std::string path, std::string source)
+	: CompileUnit(std::move(path), std::move(source), FunctionConsumer()) {
+
+}
+
+CompileUnit::CompileUnit(std::string path, std::string source, FunctionConsumer consumer)
+	: m_Path(std::move(path)), m_Lexer(std::move(source)), m_Parser(m_Lexer), m_Streamed(consumer != nullptr),
+	  m_Result(Parse(std::move(consumer))), m_Lines(m_Lexer.GetInput()), m_CallGraph(m_Parser.GetProgram()) {
+
+}
+
+CompilerResult CompileUnit::Parse(FunctionConsumer consumer) {
+	m_Parser.SetFunctionConsumer(std::move(consumer));
+	return m_Parser.Parse();
+}
+
+void CompileUnit::WriteReport(OutputBuffer& output, AstFormat format) {
+	switch (m_Result.Type) {
+		case ResultType::Success: {
+			if (format == AstFormat::Text)
+				output.Write("Success\n", 8);
+			AstEmitter emitter(output, format);
+			emitter.Emit(GetProgram());
+			break;
+		}
+		default:
+			WriteDiagnostics(output);
+			break;
+	}
+}
+
+void CompileUnit::WriteDiagnostics(OutputBuffer& output) {
+	if (m_Result.Type == ResultType::Success)
+		return;
+	for (const Diagnostic& diagnostic : m_Result.Diagnostics)
+		WriteDiagnostic(output, diagnostic);
+	output.WriteUInt(m_Result.Diagnostics.size());
+	output.Write(" error(s)\n");
+}
+
+bool CompileUnit::WriteBytecode() {
+	if (m_Result.Type != ResultType::Success || m_Streamed)
+		return false;
+
+	CodeGenerator generator;
+	BytecodeModule module;
+	CompilerResult result = generator.Generate(GetProgram(), m_CallGraph, m_Semantics, module);
+	if (result.Type != ResultType::Success) {
+		for (Diagnostic& diagnostic : result.Diagnostics)
+			AddDiagnostic(std::move(diagnostic));
+		return false;
+	}
+	return File::WriteBinaryFile(GetOutputPath(".csb"), module.Serialize());
+}
+
+bool CompileUnit::WriteInterface() {
+	if (m_Result.Type != ResultType::Success || m_Streamed)
+		return false;
+	return File::WriteBinaryFile(GetOutputPath(".csi"), ModuleInterface::Serialize(GetProgram(), m_CallGraph));
+}
+
+void CompileUnit::RemoveOutputs() {
+	std::remove(GetOutputPath(".csb").c_str());
+	std::remove(GetOutputPath(".csi").c_str());
+}
+
+void CompileUnit::Analyze(const std::vector<ModuleInterface*>& imports, SemanticCache* cache) {
+	if (m_Result.Type != ResultType::Success || m_Streamed)
+		return;
+
+	ExternalLookup lookup = [&](const std::string& name, CalleeSignature& callee) {
+		for (ModuleInterface* module : imports) {
+			const FunctionSignature* signature = module->Find(name);
+			if (signature == nullptr)
+				continue;
+			callee.ReturnType = SemanticAnalyzer::ParseType(signature->ReturnType);
+			callee.ParameterTypes.clear();
+			for (const std::string& type : signature->ParameterTypes)
+				callee.ParameterTypes.push_back(SemanticAnalyzer::ParseType(type));
+			return true;
+		}
+		return false;
+	};
+
+	SemanticAnalyzer analyzer(GetProgram(), GetSource(), lookup, cache);
+	for (const Diagnostic& diagnostic : analyzer.GetRedeclarations())
+		AddDiagnostic(diagnostic);
+
+	const auto& functions = GetProgram().Functions;
+	m_Semantics.assign(functions.size(), FunctionSemantics());
+	for (size_t i = 0; i < functions.size(); i++) {
+		// Unreachable code is never emitted, it can't fail to link either
+		if (!m_CallGraph.IsReachable(i))
+			continue;
+
+		m_Semantics[i] = analyzer.Analyze(*functions[i]);
+		for (Diagnostic diagnostic : m_Semantics[i].Diagnostics) {
+			diagnostic.Offset += functions[i]->Offset;
+			AddDiagnostic(std::move(diagnostic));
+		}
+	}
+}
+
+std::string CompileUnit::GetOutputPath(const char* extension) const {
+	std::string outputPath = m_Path;
+	size_t dot = outputPath.find_last_of('.');
+	size_t separator = outputPath.find_last_of("/\\");
+	if (dot != std::string::npos && (separator == std::string::npos || dot > separator))
+		outputPath.erase(dot);
+	return outputPath + extension;
+}
+
+void CompileUnit::AddDiagnostic(Diagnostic diagnostic) {
+	if (m_Result.Type == ResultType::Success) {
+		m_Result.Type = diagnostic.Kind;
+		m_Result.Offset = diagnostic.Offset;
+	}
+	m_Result.Diagnostics.push_back(std::move(diagnostic));
+}
+
+void CompileUnit::WriteDiagnostic(OutputBuffer& output, const Diagnostic& diagnostic) {
+	switch (diagnostic.Kind) {
+		case ResultType::InvalidToken:
+			output.Write("Invalid Token");
+			break;
+		case ResultType::InvalidSyntax:
+			output.Write("Invalid Syntax");
+			break;
+		case ResultType::InvalidEncoding:
+			output.Write("Invalid Encoding");
+			break;
+		case ResultType::UnresolvedSymbol:
+			output.Write("Unresolved Symbol");
+			break;
+		case ResultType::InvalidCall:
+			output.Write("Invalid Call");
+			break;
+		case ResultType::TypeMismatch:
+			output.Write("Type Mismatch");
+			break;
+		case ResultType::Redeclaration:
+			output.Write("Redeclaration");
+			break;
+		case ResultType::Unsupported:
+			output.Write("Unsupported");
+			break;
+		case ResultType::Failure:
+		default:
+			output.Write("Internal Compiler Error");
+			break;
+	}
+
+	SourceLocation location = m_Lines.Resolve(diagnostic.Offset);
+	output.Write(" at line ");
+	output.WriteUInt(location.Line);
+	output.Write(", column ");
+	output.WriteUInt(location.Column);
+
+	if (!diagnostic.Message.empty()) {
+		output.Write(": ");
+		output.Write(diagnostic.Message);
+		output.Put('\n');
+		return;
+	}
+
+	if (diagnostic.Expected != TokenType::Invalid) {
+		output.Write(": expected ");
+		output.Write(Lexer::TokenTypeToString(diagnostic.Expected));
+		output.Write(", got ");
+	} else {
+		output.Write(": unexpected ");
+	}
+	output.Write(Lexer::TokenTypeToString(diagnostic.Actual));
+	output.Put('\n');
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include "Compiler/Lexer.h"
+#include "Compiler/Parser.h"
+#include "Compiler/AstEmitter.h"
+#include "Compiler/CallGraph.h"
+#include "Compiler/SemanticAnalyzer.h"
+#include "Driver/ModuleInterface.h"
+#include "ErrorHandling/CompilerResult.h"
+#include "ErrorHandling/LineTable.h"
+#include "IO/OutputBuffer.h"
+
+// One parsed source file. Parsing happens on construction, the AST and the
+// diagnostics stay alive with the unit so they can be reported again later.
+class CompileUnit {
+public:
+	CompileUnit(std::string path, std::string source);
+	// Streams every function to the consumer while parsing, the unit keeps no
+	// AST and writes no bytecode or interface
+	CompileUnit(std::string path, std::string source, FunctionConsumer consumer);
+
+	CompileUnit(const CompileUnit&) = delete;
+	CompileUnit& operator=(const CompileUnit&) = delete;
+
+	// Writes the diagnostics, or the AST if parsing succeeded
+	void WriteReport(OutputBuffer& output, AstFormat format);
+	// Writes the diagnostics only, nothing if parsing succeeded
+	void WriteDiagnostics(OutputBuffer& output);
+	// Writes the bytecode next to the source file (.csl -> .csb), locals come from
+	// Analyze so it has to run first. Code generation errors become diagnostics of
+	// the unit, so report after writing.
+	bool WriteBytecode();
+	// Writes the exported declarations next to the source file (.csl -> .csi)
+	bool WriteInterface();
+	// Deletes the bytecode and interface written for the source file, if any
+	void RemoveOutputs();
+	// Resolves names and checks types of every reachable function, calls to
+	// functions this unit does not define are looked up in the imports. Unchanged
+	// functions are taken from the cache if there is one.
+	void Analyze(const std::vector<ModuleInterface*>& imports, SemanticCache* cache = nullptr);
+
+	const std::string& GetPath() const { return m_Path; }
+	const std::string& GetSource() const { return m_Lexer.GetInput(); }
+	const CompilerResult& GetResult() const { return m_Result; }
+	const ProgramNode& GetProgram() const { return m_Parser.GetProgram(); }
+	const CallGraph& GetCallGraph() const { return m_CallGraph; }
+	// Empty for unreachable functions and before Analyze
+	const std::vector<FunctionSemantics>& GetSemantics() const { return m_Semantics; }
+private:
+	CompilerResult Parse(FunctionConsumer consumer);
+	std::string GetOutputPath(const char* extension) const;
+	void AddDiagnostic(Diagnostic diagnostic);
+	void WriteDiagnostic(OutputBuffer& output, const Diagnostic& diagnostic);
+
+	std::string m_Path;
+	Lexer m_Lexer;
+	Parser m_Parser;
+	bool m_Streamed;
+	CompilerResult m_Result;
+	LineTable m_Lines;
+	CallGraph m_CallGraph;
+	std::vector<FunctionSemantics> m_Semantics; // By function index
+};
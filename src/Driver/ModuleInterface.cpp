@@ -0,0 +1,212 @@
+#include <cstring>
+#include <unordered_set>
+#include "ModuleInterface.h"
+#include "IO/File.h"
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+static const size_t s_HeaderSize = 12;
+static const size_t s_EntrySize = 16;
+
+// FNV-1a
+static uint32_t HashName(const char* data, size_t length) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (uint8_t)data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void WriteU32(std::vector<uint8_t>& out, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		out.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static void WriteString(std::vector<uint8_t>& out, const std::string& text) {
+	WriteU32(out, (uint32_t)text.size());
+	out.insert(out.end(), text.begin(), text.end());
+}
+
+std::vector<uint8_t> ModuleInterface::Serialize(const ProgramNode& program, const CallGraph& callGraph) {
+	// A function the .csb doesn't contain must not be importable either
+	std::vector<const FunctionNode*> functions;
+	std::unordered_set<std::string> seen;
+	for (size_t i = 0; i < program.Functions.size(); i++) {
+		const FunctionNode* function = program.Functions[i];
+		if (callGraph.IsReachable(i) && seen.insert(function->Name).second)
+			functions.push_back(function);
+	}
+
+	uint32_t bucketCount = 1;
+	while (bucketCount < functions.size())
+		bucketCount <<= 1;
+
+	std::vector<uint32_t> buckets(bucketCount, UINT32_MAX);
+	std::vector<uint32_t> next(functions.size(), UINT32_MAX);
+	std::vector<uint32_t> hashes(functions.size());
+	for (uint32_t i = 0; i < functions.size(); i++) {
+		hashes[i] = HashName(functions[i]->Name.data(), functions[i]->Name.size());
+		uint32_t& bucket = buckets[hashes[i] & (bucketCount - 1)];
+		next[i] = bucket;
+		bucket = i;
+	}
+
+	std::vector<uint8_t> data;
+	std::vector<uint32_t> dataOffsets(functions.size());
+	for (size_t i = 0; i < functions.size(); i++) {
+		const FunctionNode& function = *functions[i];
+		dataOffsets[i] = (uint32_t)data.size();
+		data.insert(data.end(), function.Name.begin(), function.Name.end());
+		WriteString(data, function.ReturnType);
+		WriteU32(data, (uint32_t)function.ParameterTypes.size());
+		for (const std::string& type : function.ParameterTypes)
+			WriteString(data, type);
+	}
+
+	std::vector<uint8_t> out;
+	out.reserve(s_HeaderSize + bucketCount * 4 + functions.size() * s_EntrySize + data.size());
+	for (char c : {'C', 'S', 'I', '1'})
+		out.push_back((uint8_t)c);
+	WriteU32(out, (uint32_t)functions.size());
+	WriteU32(out, bucketCount);
+	for (uint32_t bucket : buckets)
+		WriteU32(out, bucket);
+	for (size_t i = 0; i < functions.size(); i++) {
+		WriteU32(out, hashes[i]);
+		WriteU32(out, next[i]);
+		WriteU32(out, dataOffsets[i]);
+		WriteU32(out, (uint32_t)functions[i]->Name.size());
+	}
+	out.insert(out.end(), data.begin(), data.end());
+	return out;
+}
+
+ModuleInterface::~ModuleInterface() {
+#ifndef _WIN32
+	if (m_Mapped)
+		munmap(const_cast<uint8_t*>(m_Data), m_Size);
+#endif
+}
+
+bool ModuleInterface::Open(const std::string& path) {
+	m_Path = path;
+
+#ifndef _WIN32
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				m_Data = static_cast<const uint8_t*>(data);
+				m_Size = (size_t)info.st_size;
+				m_Mapped = true;
+			}
+		}
+		::close(fd);
+	}
+#endif
+
+	if (!m_Mapped) {
+		m_Buffer = File::ReadBinaryFile(path);
+		m_Data = m_Buffer.data();
+		m_Size = m_Buffer.size();
+	}
+	return Validate();
+}
+
+bool ModuleInterface::Validate() {
+	if (m_Size < s_HeaderSize || std::memcmp(m_Data, "CSI1", 4) != 0)
+		return false;
+
+	m_SymbolCount = ReadU32(4);
+	m_BucketCount = ReadU32(8);
+	if (m_BucketCount == 0 || (m_BucketCount & (m_BucketCount - 1)) != 0)
+		return false;
+
+	// Only the fixed size tables are checked here, entries are checked when decoded
+	uint64_t tables = s_HeaderSize + (uint64_t)m_BucketCount * 4 + (uint64_t)m_SymbolCount * s_EntrySize;
+	return tables <= m_Size;
+}
+
+uint32_t ModuleInterface::ReadU32(size_t offset) const {
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value |= (uint32_t)m_Data[offset + i] << (i * 8);
+	return value;
+}
+
+const FunctionSignature* ModuleInterface::Find(const std::string& name) {
+	if (m_BucketCount == 0)
+		return nullptr;
+
+	uint32_t hash = HashName(name.data(), name.size());
+	size_t entriesStart = s_HeaderSize + (size_t)m_BucketCount * 4;
+	size_t dataStart = entriesStart + (size_t)m_SymbolCount * s_EntrySize;
+
+	uint32_t entry = ReadU32(s_HeaderSize + (size_t)(hash & (m_BucketCount - 1)) * 4);
+	// Bounded by the symbol count so a damaged chain can't loop forever
+	for (uint32_t steps = 0; entry < m_SymbolCount && steps < m_SymbolCount; steps++) {
+		size_t offset = entriesStart + (size_t)entry * s_EntrySize;
+		uint32_t dataOffset = ReadU32(offset + 8);
+		uint32_t nameLength = ReadU32(offset + 12);
+
+		if (ReadU32(offset) == hash && nameLength == name.size() && (uint64_t)dataStart + dataOffset + nameLength <= m_Size &&
+			std::memcmp(m_Data + dataStart + dataOffset, name.data(), nameLength) == 0) {
+			auto it = m_Loaded.find(entry);
+			if (it != m_Loaded.end())
+				return &it->second;
+
+			FunctionSignature signature;
+			if (!Decode(entry, signature))
+				return nullptr;
+			return &m_Loaded.emplace(entry, std::move(signature)).first->second;
+		}
+		entry = ReadU32(offset + 4);
+	}
+	return nullptr;
+}
+
+bool ModuleInterface::Decode(uint32_t entry, FunctionSignature& signature) const {
+	size_t entriesStart = s_HeaderSize + (size_t)m_BucketCount * 4;
+	size_t dataStart = entriesStart + (size_t)m_SymbolCount * s_EntrySize;
+	size_t offset = entriesStart + (size_t)entry * s_EntrySize;
+
+	size_t pos = dataStart + ReadU32(offset + 8);
+	uint32_t nameLength = ReadU32(offset + 12);
+	auto readString = [&](std::string& text, uint32_t length) {
+		if (length > m_Size || pos > m_Size - length)
+			return false;
+		text.assign(reinterpret_cast<const char*>(m_Data + pos), length);
+		pos += length;
+		return true;
+	};
+	auto readLength = [&](uint32_t& value) {
+		if (pos > m_Size - 4)
+			return false;
+		value = ReadU32(pos);
+		pos += 4;
+		return true;
+	};
+
+	uint32_t length;
+	if (!readString(signature.Name, nameLength) || !readLength(length) || !readString(signature.ReturnType, length))
+		return false;
+
+	uint32_t parameterCount;
+	if (!readLength(parameterCount))
+		return false;
+	for (uint32_t i = 0; i < parameterCount; i++) {
+		std::string type;
+		if (!readLength(length) || !readString(type, length))
+			return false;
+		signature.ParameterTypes.push_back(std::move(type));
+	}
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Compiler/CallGraph.h"
+#include "Compiler/Parser.h"
+
+struct FunctionSignature {
+	std::string Name;
+	std::string ReturnType;
+	std::vector<std::string> ParameterTypes;
+};
+
+// Exported declarations of a compiled file (.csi). The file is mapped as is and
+// only the hash index is consulted up front, a signature is decoded the first
+// time it is looked up. Importing a large module therefore costs as much as the
+// symbols that are actually referenced.
+//
+// Layout, all integers are little endian u32:
+//   "CSI1", symbol count, bucket count (power of two)
+//   buckets: index of the first entry of the chain, UINT32_MAX if empty
+//   entries: name hash, next entry in the chain, data offset, name length
+//   data: per entry the name, then the return type, parameter count and
+//         parameter types as length prefixed strings
+class ModuleInterface {
+public:
+	ModuleInterface() = default;
+	~ModuleInterface();
+
+	ModuleInterface(const ModuleInterface&) = delete;
+	ModuleInterface& operator=(const ModuleInterface&) = delete;
+
+	// Exports the same functions the bytecode keeps, the reachable ones
+	static std::vector<uint8_t> Serialize(const ProgramNode& program, const CallGraph& callGraph);
+
+	bool Open(const std::string& path);
+	const std::string& GetPath() const { return m_Path; }
+
+	// Nullptr if the module does not export the name or the entry is damaged
+	const FunctionSignature* Find(const std::string& name);
+
+	size_t GetSymbolCount() const { return m_SymbolCount; }
+	size_t GetLoadedCount() const { return m_Loaded.size(); }
+private:
+	bool Validate();
+	bool Decode(uint32_t entry, FunctionSignature& signature) const;
+	uint32_t ReadU32(size_t offset) const;
+
+	std::string m_Path;
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_Mapped = false;
+	std::vector<uint8_t> m_Buffer; // Used where the file can't be mapped
+	uint32_t m_SymbolCount = 0;
+	uint32_t m_BucketCount = 0;
+	std::unordered_map<uint32_t, FunctionSignature> m_Loaded; // By entry index
+};
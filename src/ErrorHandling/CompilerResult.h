@@ -1,16 +1,38 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Compiler/Lexer.h"
+
 enum class ResultType{
     Success,
     InvalidToken,
     InvalidSyntax,
+    InvalidEncoding,
+    UnresolvedSymbol,
+    InvalidCall,
+    TypeMismatch,
+    Redeclaration,
+    Unsupported,
     Failure
 };
 
+struct Diagnostic {
+    ResultType Kind;
+    uint32_t Offset;
+    TokenType Expected; // Invalid if no particular token was expected
+    TokenType Actual;
+    std::string Message = ""; // Replaces the token description if set
+};
+
 struct CompilerResult {
-    CompilerResult(ResultType type){
+    CompilerResult(ResultType type, uint32_t offset = 0){
         Type = type;
+        Offset = offset;
     }
 
     ResultType Type;
+    uint32_t Offset; // Source offset of the first error, see LineTable
+    std::vector<Diagnostic> Diagnostics; // Every error found, empty on success
 };
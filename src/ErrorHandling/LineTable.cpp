@@ -0,0 +1,66 @@
+#include <algorithm>
+#include "LineTable.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CSC_LINE_TABLE_SSE2
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+#ifdef CSC_LINE_TABLE_SSE2
+static inline int CountTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+SourceLocation LineTable::Resolve(uint32_t offset) {
+	if (!m_Built)
+		Build();
+
+	offset = std::min<uint32_t>(offset, (uint32_t)m_Source.length());
+
+	// Last line start that is <= offset
+	auto it = std::upper_bound(m_LineStarts.begin(), m_LineStarts.end(), offset);
+	size_t line = (size_t)(it - m_LineStarts.begin());
+
+	SourceLocation location;
+	location.Line = (uint32_t)line;
+	location.Column = offset - m_LineStarts[line - 1] + 1;
+	return location;
+}
+
+void LineTable::Build() {
+	m_Built = true;
+	m_LineStarts.clear();
+	m_LineStarts.push_back(0);
+
+	const char* data = m_Source.data();
+	size_t length = m_Source.length();
+	size_t pos = 0;
+
+#ifdef CSC_LINE_TABLE_SSE2
+	// Compare 16 bytes at a time and walk the set bits of the newline mask
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; pos + 16 <= length; pos += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+		while (mask != 0) {
+			m_LineStarts.push_back((uint32_t)(pos + CountTrailingZeros(mask) + 1));
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; pos < length; pos++) {
+		if (data[pos] == '\n')
+			m_LineStarts.push_back((uint32_t)(pos + 1));
+	}
+}
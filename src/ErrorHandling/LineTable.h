@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SourceLocation {
+	uint32_t Line = 1;
+	uint32_t Column = 1;
+};
+
+// Maps byte offsets to line/column. The table of line starts is only built the
+// first time a location is resolved, so successful compiles never pay for it.
+class LineTable {
+public:
+	explicit LineTable(const std::string& source) : m_Source(source) {}
+
+	SourceLocation Resolve(uint32_t offset);
+private:
+	void Build();
+
+	const std::string& m_Source;
+	std::vector<uint32_t> m_LineStarts;
+	bool m_Built = false;
+};
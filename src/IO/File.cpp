@@ -2,16 +2,36 @@
 #include <fstream>
 #include "File.h"
 
-std::string File::ReadTextFile(const std::string &filename) {
+bool File::ReadTextFile(const std::string &filename, std::string& content) {
 	std::ifstream file(filename);
 	if (!file) {
 		std::cerr << "Failed to open file: " << filename << std::endl;
-		return "";
+		return false;
 	}
 
-	std::string content((std::istreambuf_iterator<char>(file)), (std::istreambuf_iterator<char>()));
-	file.close();
-	return content;
+	// Regular files are sized up front, growing would briefly need twice the file size
+	content.clear();
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file ? (std::streamoff)file.tellg() : -1;
+	file.clear();
+	if (size > 0) {
+		file.seekg(0, std::ios::beg);
+		content.resize((size_t)size);
+		file.read(&content[0], size);
+		content.resize((size_t)file.gcount());
+	}
+
+	// Pipes, FIFOs and /dev/stdin can't seek and have no size, they are read in
+	// chunks. For regular files this only picks up what was appended meanwhile.
+	char buffer[64 * 1024];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+		content.append(buffer, (size_t)file.gcount());
+
+	if (file.bad()) {
+		std::cerr << "Failed to read file: " << filename << std::endl;
+		return false;
+	}
+	return true;
 }
 
 std::vector<unsigned char> File::ReadBinaryFile(const std::string &filename) {
@@ -25,3 +45,15 @@ std::vector<unsigned char> File::ReadBinaryFile(const std::string &filename) {
 	file.close();
 	return content;
 }
+
+bool File::WriteBinaryFile(const std::string &filename, const std::vector<unsigned char> &content) {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cerr << "Failed to open file: " << filename << std::endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(content.data()), (std::streamsize)content.size());
+	file.close();
+	return true;
+}
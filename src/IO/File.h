@@ -5,6 +5,8 @@
 
 class File {
 	public:
-		static std::string ReadTextFile(const std::string& filename);
+		// False if the file can't be opened or read, content is then undefined
+		static bool ReadTextFile(const std::string& filename, std::string& content);
 		static std::vector<unsigned char> ReadBinaryFile(const std::string& filename);
+		static bool WriteBinaryFile(const std::string& filename, const std::vector<unsigned char>& content);
 };
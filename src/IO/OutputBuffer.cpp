@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "OutputBuffer.h"
+
+#ifdef _WIN32
+	#include <io.h>
+	#define WriteFd _write
+#else
+	#include <unistd.h>
+	#define WriteFd ::write
+#endif
+
+OutputBuffer::OutputBuffer(int fd, size_t capacity) : m_Fd(fd), m_Buffer(capacity == 0 ? 1 : capacity) {
+
+}
+
+OutputBuffer::~OutputBuffer() {
+	Flush();
+}
+
+void OutputBuffer::Write(const char* data, size_t length) {
+	if (m_Size + length > m_Buffer.size()) {
+		Flush();
+		// Too large to be worth copying, pass it straight through
+		if (length >= m_Buffer.size()) {
+			while (length > 0) {
+				auto written = WriteFd(m_Fd, data, (unsigned)length);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return;
+				data += written;
+				length -= (size_t)written;
+			}
+			return;
+		}
+	}
+	std::memcpy(m_Buffer.data() + m_Size, data, length);
+	m_Size += length;
+}
+
+void OutputBuffer::WriteIndent(size_t count) {
+	while (count > 0) {
+		if (m_Size == m_Buffer.size())
+			Flush();
+		size_t chunk = std::min(count, m_Buffer.size() - m_Size);
+		std::memset(m_Buffer.data() + m_Size, ' ', chunk);
+		m_Size += chunk;
+		count -= chunk;
+	}
+}
+
+void OutputBuffer::WriteInt(int64_t value) {
+	if (value < 0) {
+		Put('-');
+		WriteUInt(0 - (uint64_t)value);
+		return;
+	}
+	WriteUInt((uint64_t)value);
+}
+
+void OutputBuffer::WriteUInt(uint64_t value) {
+	char digits[20];
+	size_t count = 0;
+	do {
+		digits[sizeof(digits) - ++count] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	Write(digits + sizeof(digits) - count, count);
+}
+
+bool OutputBuffer::Flush() {
+	size_t done = 0;
+	while (done < m_Size) {
+		auto written = WriteFd(m_Fd, m_Buffer.data() + done, (unsigned)(m_Size - done));
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0) {
+			m_Size = 0;
+			return false;
+		}
+		done += (size_t)written;
+	}
+	m_Size = 0;
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Collects output in one large buffer and hands it to the OS with a single
+// write() per flush instead of going through iostreams per character.
+class OutputBuffer {
+public:
+	explicit OutputBuffer(int fd = 1, size_t capacity = 1 << 16);
+	~OutputBuffer();
+
+	OutputBuffer(const OutputBuffer&) = delete;
+	OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+	void Write(const char* data, size_t length);
+	void Write(const char* text) { Write(text, std::strlen(text)); }
+	void Write(const std::string& text) { Write(text.data(), text.size()); }
+	void Put(char c) {
+		if (m_Size == m_Buffer.size())
+			Flush();
+		m_Buffer[m_Size++] = c;
+	}
+	void WriteIndent(size_t count);
+	void WriteInt(int64_t value);
+	void WriteUInt(uint64_t value);
+
+	bool Flush();
+	int GetFd() const { return m_Fd; }
+private:
+	int m_Fd;
+	std::vector<char> m_Buffer;
+	size_t m_Size = 0;
+};
@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <iterator>
+#include "ExecutionEngine.h"
+
+Value Value::FromInt(int64_t value) {
+	Value result;
+	result.Type = ValueType::Int;
+	result.Int = value;
+	return result;
+}
+
+Value Value::FromString(std::string value) {
+	Value result;
+	result.Type = ValueType::String;
+	result.String = std::move(value);
+	return result;
+}
+
+bool Value::IsTruthy() const {
+	switch (Type) {
+		case ValueType::Int: return Int != 0;
+		case ValueType::String: return !String.empty();
+		default: return false;
+	}
+}
+
+static uint32_t ReadU32(const uint8_t* code) {
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value |= (uint32_t)code[i] << (i * 8);
+	return value;
+}
+
+static uint64_t ReadU64(const uint8_t* code) {
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++)
+		value |= (uint64_t)code[i] << (i * 8);
+	return value;
+}
+
+ExecutionEngine::ExecutionEngine(const ProgramNode& program, const std::vector<FunctionSemantics>& semantics,
+	uint64_t tierUpThreshold) : m_Program(program), m_Semantics(semantics), m_TierUpThreshold(tierUpThreshold) {
+	const auto& functions = program.Functions;
+
+	// A name that can't be interned stays unknown and fails when it is called
+	for (size_t i = 0; i < functions.size(); i++)
+		m_Functions.Add(functions[i]->Name, (uint32_t)i);
+
+	m_Profiles.resize(functions.size());
+	m_Chunks.resize(functions.size());
+}
+
+bool ExecutionEngine::Run(const std::string& entry, Value& result) {
+	m_Error.clear();
+
+	uint32_t function = m_Functions.Find(entry);
+	if (function == FunctionTable::s_NoFunction)
+		return Fail("no function named " + entry);
+
+	std::vector<Value> arguments;
+	return Call(function, arguments, result);
+}
+
+bool ExecutionEngine::Call(uint32_t function, std::vector<Value>& arguments, Value& result) {
+	if (m_CallDepth >= s_MaxCallDepth)
+		return Fail("call stack overflow in " + m_Program.Functions[function]->Name);
+
+	FunctionProfile& profile = m_Profiles[function];
+	profile.Calls++;
+	if (profile.CurrentTier == Tier::Interpreter && profile.Calls + profile.BackEdges >= m_TierUpThreshold
+		&& !TierUp(function))
+		return false;
+
+	m_CallDepth++;
+	bool ok = profile.CurrentTier == Tier::Bytecode
+		? Execute(function, arguments, result)
+		: Interpret(function, arguments, result);
+	m_CallDepth--;
+	return ok;
+}
+
+bool ExecutionEngine::TierUp(uint32_t function) {
+	FunctionProfile& profile = m_Profiles[function];
+	if (function >= m_Semantics.size())
+		return Fail("can't compile " + m_Program.Functions[function]->Name + ": the program was not analyzed");
+	CompilerResult result = CodeGenerator::GenerateFunction(*m_Program.Functions[function], m_Semantics[function],
+		m_Functions, m_Chunks[function]);
+	if (result.Type != ResultType::Success)
+		return Fail("can't compile " + m_Program.Functions[function]->Name + ": " + result.Diagnostics.front().Message);
+	profile.CurrentTier = Tier::Bytecode;
+	m_TierUps.push_back({function, profile.Calls, profile.BackEdges});
+	return true;
+}
+
+bool ExecutionEngine::Interpret(uint32_t function, std::vector<Value>& arguments, Value& result) {
+	const FunctionNode& node = *m_Program.Functions[function];
+
+	if (function >= m_Semantics.size())
+		return Fail("can't run " + node.Name + ": the program was not analyzed");
+
+	// Missing arguments are void, extra ones are dropped, like in bytecode
+	Frame frame;
+	frame.Function = &node;
+	frame.Semantics = &m_Semantics[function];
+	frame.Locals.resize(std::max<size_t>(frame.Semantics->SlotCount, node.Parameters.size()));
+	for (size_t i = 0; i < node.Parameters.size() && i < arguments.size(); i++)
+		frame.Locals[i] = std::move(arguments[i]);
+
+	// Nested blocks and bodies are pushed instead of recursed into, so nesting
+	// depth is bounded by memory rather than by the native stack
+	std::vector<Task> tasks;
+	tasks.push_back({&node.Block, nullptr, nullptr, 0});
+	while (!tasks.empty() && !frame.Returned) {
+		Task& task = tasks.back();
+		const Expression* statement;
+		if (task.Block != nullptr) {
+			if (task.Next == task.Block->Expressions.size()) {
+				tasks.pop_back();
+				continue;
+			}
+			statement = &task.Block->Expressions[task.Next++];
+		} else if (task.Loop != nullptr) {
+			const WhileExpression* loop = task.Loop;
+			if (task.Next++ > 0)
+				m_Profiles[function].BackEdges++;
+			Value condition;
+			if (!EvaluateExpression(loop->ConditionExpression, frame, condition))
+				return false;
+			if (!condition.IsTruthy()) {
+				tasks.pop_back();
+				continue;
+			}
+			statement = loop->BodyExpression;
+		} else {
+			statement = task.Single;
+			tasks.pop_back();
+		}
+
+		if (statement != nullptr && !InterpretStatement(*statement, frame, tasks))
+			return false;
+	}
+
+	result = std::move(frame.ReturnValue);
+	return true;
+}
+
+bool ExecutionEngine::InterpretStatement(const Expression& expression, Frame& frame, std::vector<Task>& tasks) {
+	Value value;
+	switch (expression.Type) {
+		case ExpressionType::Declaration: {
+			// A slot is reused by sibling blocks, a new declaration starts out void
+			Value* local = GetLocal(frame, reinterpret_cast<DeclarationExpression*>(expression.Data)->Identifier, expression.Offset);
+			if (local == nullptr)
+				return false;
+			*local = Value();
+			return true;
+		}
+		case ExpressionType::Assignment: {
+			auto* assignment = reinterpret_cast<AssignmentExpression*>(expression.Data);
+			if (!EvaluateExpression(assignment->ValueExpression, frame, value))
+				return false;
+			Value* local = GetLocal(frame, assignment->Identifier, expression.Offset);
+			if (local == nullptr)
+				return false;
+			*local = std::move(value);
+			return true;
+		}
+		case ExpressionType::DeclarationWithAssignment: {
+			auto* dec = reinterpret_cast<InitializationExpression*>(expression.Data);
+			if (!EvaluateExpression(dec->ValueExpression, frame, value))
+				return false;
+			Value* local = GetLocal(frame, dec->Identifier, expression.Offset);
+			if (local == nullptr)
+				return false;
+			*local = std::move(value);
+			return true;
+		}
+		case ExpressionType::Block:
+			tasks.push_back({reinterpret_cast<BlockExpression*>(expression.Data), nullptr, nullptr, 0});
+			return true;
+		case ExpressionType::FunctionCall:
+		case ExpressionType::Value:
+		case ExpressionType::UnaryOperation:
+		case ExpressionType::BinaryOperation:
+			return EvaluateExpression(&expression, frame, value);
+		case ExpressionType::Return: {
+			auto* returnExpression = reinterpret_cast<ReturnExpression*>(expression.Data);
+			if (!EvaluateValue(returnExpression->Value, frame, frame.ReturnValue))
+				return false;
+			frame.Returned = true;
+			return true;
+		}
+		case ExpressionType::While: {
+			auto* whileExpression = reinterpret_cast<WhileExpression*>(expression.Data);
+			// The parser skips conditions and bodies for now, running the statement
+			// as if it were empty would silently change the program
+			if (whileExpression->ConditionExpression == nullptr)
+				return Fail("while statements are not supported yet");
+			tasks.push_back({nullptr, nullptr, whileExpression, 0});
+			return true;
+		}
+		case ExpressionType::If: {
+			auto* ifExpression = reinterpret_cast<IfExpression*>(expression.Data);
+			if (ifExpression->ConditionExpression == nullptr)
+				return Fail("if statements are not supported yet");
+			if (!EvaluateExpression(ifExpression->ConditionExpression, frame, value))
+				return false;
+			frame.LastIfTaken = value.IsTruthy();
+			if (frame.LastIfTaken)
+				tasks.push_back({nullptr, ifExpression->BodyExpression, nullptr, 0});
+			return true;
+		}
+		case ExpressionType::Else: {
+			auto* elseExpression = reinterpret_cast<ElseExpression*>(expression.Data);
+			if (elseExpression->BodyExpression == nullptr)
+				return Fail("else statements are not supported yet");
+			if (!frame.LastIfTaken)
+				tasks.push_back({nullptr, elseExpression->BodyExpression, nullptr, 0});
+			return true;
+		}
+	}
+	return true;
+}
+
+Value* ExecutionEngine::GetLocal(Frame& frame, const std::string& name, uint32_t offset) {
+	uint32_t slot = frame.Semantics->GetSlot(*frame.Function, offset);
+	if (slot >= frame.Locals.size()) {
+		Fail("no variable named " + name + " in " + frame.Function->Name);
+		return nullptr;
+	}
+	return &frame.Locals[slot];
+}
+
+bool ExecutionEngine::EvaluateExpression(const Expression* expression, Frame& frame, Value& result) {
+	result = Value();
+	if (expression == nullptr)
+		return true;
+
+	switch (expression->Type) {
+		case ExpressionType::Value:
+			return EvaluateValue(reinterpret_cast<ValueExpression*>(expression->Data), frame, result);
+		case ExpressionType::FunctionCall:
+			return EvaluateCall(reinterpret_cast<FunctionCallExpression*>(expression->Data), frame, result);
+		case ExpressionType::UnaryOperation:
+			return Fail("unary operations are not supported yet");
+		case ExpressionType::BinaryOperation:
+			return Fail("binary operations are not supported yet");
+		default:
+			return Fail("expression can't be used as a value");
+	}
+}
+
+bool ExecutionEngine::EvaluateValue(const ValueExpression* value, Frame& frame, Value& result) {
+	result = Value();
+	if (value == nullptr)
+		return true;
+
+	switch (value->Type) {
+		case ValueExpressionType::FunctionCall:
+			return EvaluateCall(value->FunctionCall, frame, result);
+		case ValueExpressionType::Literal:
+		case ValueExpressionType::IntLiteral:
+			result = Value::FromInt(value->ValueLiteral);
+			break;
+		case ValueExpressionType::FloatLiteral:
+			return Fail("floating point values are not supported yet");
+		case ValueExpressionType::StringLiteral:
+			result = Value::FromString(value->StringLiteral);
+			break;
+		case ValueExpressionType::Variable: {
+			Value* local = GetLocal(frame, value->VariableName, value->Offset);
+			if (local == nullptr)
+				return false;
+			result = *local;
+			break;
+		}
+	}
+	return true;
+}
+
+bool ExecutionEngine::EvaluateCall(const FunctionCallExpression* call, Frame& frame, Value& result) {
+	result = Value();
+	if (call == nullptr)
+		return true;
+
+	// The analyzer resolved everything else through the imports
+	uint32_t function = m_Functions.Find(call->Name);
+	if (function == FunctionTable::s_NoFunction)
+		return Fail("can't call " + call->Name + ": imported functions can't be run yet");
+
+	std::vector<Value> arguments(call->Arguments.size());
+	for (size_t i = 0; i < call->Arguments.size(); i++) {
+		if (!EvaluateValue(call->Arguments[i], frame, arguments[i]))
+			return false;
+	}
+	return Call(function, arguments, result);
+}
+
+bool ExecutionEngine::Execute(uint32_t function, std::vector<Value>& arguments, Value& result) {
+	const BytecodeChunk& chunk = m_Chunks[function];
+	const uint8_t* code = chunk.Code.data();
+	size_t parameterCount = m_Program.Functions[function]->Parameters.size();
+
+	std::vector<Value> locals(chunk.LocalCount);
+	for (size_t i = 0; i < parameterCount && i < arguments.size() && i < locals.size(); i++)
+		locals[i] = std::move(arguments[i]);
+
+	std::vector<Value> stack;
+	size_t pc = 0;
+	while (pc < chunk.Code.size()) {
+		switch ((OpCode)code[pc++]) {
+			case OpCode::Nop:
+				break;
+			case OpCode::PushInt:
+				stack.push_back(Value::FromInt((int64_t)ReadU64(code + pc)));
+				pc += 8;
+				break;
+			case OpCode::PushString:
+				stack.push_back(Value::FromString(chunk.Strings[ReadU32(code + pc)]));
+				pc += 4;
+				break;
+			case OpCode::PushVoid:
+				stack.emplace_back();
+				break;
+			case OpCode::Load:
+				stack.push_back(locals[ReadU32(code + pc)]);
+				pc += 4;
+				break;
+			case OpCode::Store:
+				locals[ReadU32(code + pc)] = std::move(stack.back());
+				stack.pop_back();
+				pc += 4;
+				break;
+			case OpCode::Pop:
+				stack.pop_back();
+				break;
+			case OpCode::Call: {
+				uint32_t callee = ReadU32(code + pc);
+				uint32_t argumentCount = ReadU32(code + pc + 4);
+				pc += 8;
+				if (callee == UINT32_MAX)
+					return Fail("call to unknown function from " + m_Program.Functions[function]->Name);
+
+				std::vector<Value> callArguments(std::make_move_iterator(stack.end() - argumentCount),
+					std::make_move_iterator(stack.end()));
+				stack.resize(stack.size() - argumentCount);
+				Value value;
+				if (!Call(callee, callArguments, value))
+					return false;
+				stack.push_back(std::move(value));
+				break;
+			}
+			case OpCode::CallImport:
+				return Fail("can't call " + chunk.Imports[ReadU32(code + pc)] + ": imported functions can't be run yet");
+			case OpCode::Jump:
+			case OpCode::JumpIfFalse: {
+				bool conditional = (OpCode)code[pc - 1] == OpCode::JumpIfFalse;
+				int32_t relative = (int32_t)ReadU32(code + pc);
+				pc += 4;
+				if (conditional) {
+					bool taken = !stack.back().IsTruthy();
+					stack.pop_back();
+					if (!taken)
+						break;
+				}
+				if (relative < 0)
+					m_Profiles[function].BackEdges++;
+				pc = (size_t)((int64_t)pc + relative);
+				break;
+			}
+			case OpCode::Return:
+				result = std::move(stack.back());
+				return true;
+			default:
+				return Fail("invalid instruction in " + m_Program.Functions[function]->Name);
+		}
+	}
+
+	result = Value();
+	return true;
+}
+
+bool ExecutionEngine::Fail(std::string message) {
+	if (m_Error.empty())
+		m_Error = std::move(message);
+	return false;
+}
+
+void ExecutionEngine::WriteProfile(OutputBuffer& output) const {
+	output.Write("Profile (tier-up threshold ");
+	output.WriteUInt(m_TierUpThreshold);
+	output.Write(")\n");
+
+	for (size_t i = 0; i < m_Profiles.size(); i++) {
+		const FunctionProfile& profile = m_Profiles[i];
+		if (profile.Calls == 0)
+			continue;
+		output.Write("  ");
+		output.Write(m_Program.Functions[i]->Name);
+		output.Write(": calls ");
+		output.WriteUInt(profile.Calls);
+		output.Write(", back edges ");
+		output.WriteUInt(profile.BackEdges);
+		output.Write(profile.CurrentTier == Tier::Bytecode ? ", bytecode\n" : ", interpreter\n");
+	}
+
+	for (const TierUpEvent& event : m_TierUps) {
+		output.Write("Tier-up: ");
+		output.Write(m_Program.Functions[event.Function]->Name);
+		output.Write(" after ");
+		output.WriteUInt(event.Calls);
+		output.Write(" calls, ");
+		output.WriteUInt(event.BackEdges);
+		output.Write(" back edges\n");
+	}
+}
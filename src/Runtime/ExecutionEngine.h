@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Compiler/Parser.h"
+#include "Compiler/CodeGenerator.h"
+#include "IO/OutputBuffer.h"
+
+enum class ValueType : uint8_t {
+	Void,
+	Int,
+	String
+};
+
+struct Value {
+	ValueType Type = ValueType::Void;
+	int64_t Int = 0;
+	std::string String;
+
+	static Value FromInt(int64_t value);
+	static Value FromString(std::string value);
+	bool IsTruthy() const;
+};
+
+enum class Tier : uint8_t {
+	Interpreter,
+	Bytecode
+};
+
+struct FunctionProfile {
+	uint64_t Calls = 0;
+	uint64_t BackEdges = 0;
+	Tier CurrentTier = Tier::Interpreter;
+};
+
+struct TierUpEvent {
+	uint32_t Function;
+	uint64_t Calls;
+	uint64_t BackEdges;
+};
+
+// Runs a parsed program. Every function starts out in a tree walking
+// interpreter, which costs nothing up front. Once the calls plus loop back
+// edges of a function reach the threshold it is lowered to bytecode and all
+// further calls run on the bytecode loop, so only the functions that dominate
+// run time pay for code generation. The bytecode is not optimized, the second
+// tier gains only from slot indexed locals and a flat instruction loop instead
+// of walking the tree and looking names up in a map.
+class ExecutionEngine {
+public:
+	static constexpr uint64_t s_DefaultTierUpThreshold = 1000;
+
+	// The semantics give the bytecode its locals, one entry per function of the
+	// program like CompileUnit::GetSemantics
+	ExecutionEngine(const ProgramNode& program, const std::vector<FunctionSemantics>& semantics,
+		uint64_t tierUpThreshold = s_DefaultTierUpThreshold);
+
+	// Calls the entry function without arguments. Returns false on a runtime
+	// error, see GetError.
+	bool Run(const std::string& entry, Value& result);
+	const std::string& GetError() const { return m_Error; }
+
+	const std::vector<FunctionProfile>& GetProfiles() const { return m_Profiles; }
+	const std::vector<TierUpEvent>& GetTierUps() const { return m_TierUps; }
+	void WriteProfile(OutputBuffer& output) const;
+private:
+	struct Frame {
+		const FunctionNode* Function;
+		const FunctionSemantics* Semantics;
+		std::vector<Value> Locals; // By semantic slot, the same layout as in bytecode
+		Value ReturnValue;
+		bool Returned = false;
+		bool LastIfTaken = false;
+	};
+
+	// Pending work of the interpreter within one function, exactly one of the
+	// pointers is set
+	struct Task {
+		const BlockExpression* Block;  // Runs the statements from Next on
+		const Expression* Single;      // Runs once, the body of an if or else
+		const WhileExpression* Loop;   // Checks the condition, then runs the body
+		size_t Next;                   // Next statement, or iterations of the loop
+	};
+
+	bool Call(uint32_t function, std::vector<Value>& arguments, Value& result);
+	bool TierUp(uint32_t function);
+
+	bool Interpret(uint32_t function, std::vector<Value>& arguments, Value& result);
+	bool InterpretStatement(const Expression& expression, Frame& frame, std::vector<Task>& tasks);
+	Value* GetLocal(Frame& frame, const std::string& name, uint32_t offset);
+	bool EvaluateExpression(const Expression* expression, Frame& frame, Value& result);
+	bool EvaluateValue(const ValueExpression* value, Frame& frame, Value& result);
+	bool EvaluateCall(const FunctionCallExpression* call, Frame& frame, Value& result);
+
+	bool Execute(uint32_t function, std::vector<Value>& arguments, Value& result);
+
+	bool Fail(std::string message);
+
+	// Calls recurse on the native stack in both tiers, nesting within a function
+	// doesn't. This stays within a 1 MB stack even in debug builds.
+	static constexpr uint32_t s_MaxCallDepth = 512;
+
+	const ProgramNode& m_Program;
+	const std::vector<FunctionSemantics>& m_Semantics;
+	FunctionTable m_Functions;
+	std::vector<FunctionProfile> m_Profiles;
+	std::vector<BytecodeChunk> m_Chunks; // Empty until the function tiers up
+	std::vector<TierUpEvent> m_TierUps;
+	uint64_t m_TierUpThreshold;
+	uint32_t m_CallDepth = 0;
+	std::string m_Error;
+};
@@ -0,0 +1,351 @@
+#include <iostream>
+#include <iterator>
+#include <new>
+#include "CompileServer.h"
+#include "IO/File.h"
+
+#ifndef _WIN32
+	#include <algorithm>
+	#include <cerrno>
+	#include <csignal>
+	#include <cstdlib>
+	#include <climits>
+	#include <sys/socket.h>
+	#include <sys/stat.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+
+	#ifndef MSG_NOSIGNAL
+		#define MSG_NOSIGNAL 0
+	#endif
+#endif
+
+#ifndef _WIN32
+static bool SendAll(int fd, const char* data, size_t length) {
+	while (length > 0) {
+		ssize_t sent = ::send(fd, data, length, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0)
+			return false;
+		data += sent;
+		length -= (size_t)sent;
+	}
+	return true;
+}
+
+static bool ReceiveAll(int fd, char* data, size_t length) {
+	while (length > 0) {
+		ssize_t received = ::recv(fd, data, length, 0);
+		if (received < 0 && errno == EINTR)
+			continue;
+		if (received <= 0)
+			return false;
+		data += received;
+		length -= (size_t)received;
+	}
+	return true;
+}
+
+static bool ReceiveLine(int fd, std::string& line) {
+	line.clear();
+	char c;
+	while (line.size() < 4096) {
+		if (!ReceiveAll(fd, &c, 1))
+			return false;
+		if (c == '\n')
+			return true;
+		line += c;
+	}
+	return false;
+}
+
+static void SendError(int fd, const std::string& message) {
+	std::string response = std::to_string((int)ResultType::Failure) + "\n" + message + "\n";
+	SendAll(fd, response.data(), response.size());
+}
+
+static bool MakeAddress(const std::string& path, sockaddr_un& address) {
+	if (path.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Socket path too long: " << path << std::endl;
+		return false;
+	}
+	address = {};
+	address.sun_family = AF_UNIX;
+	std::copy(path.begin(), path.end(), address.sun_path);
+	return true;
+}
+#endif
+
+CompileServer::CompileServer(std::string socketPath) : m_SocketPath(std::move(socketPath)) {
+
+}
+
+CompileServer::~CompileServer() {
+#ifndef _WIN32
+	if (m_ListenFd >= 0) {
+		::close(m_ListenFd);
+		::unlink(m_SocketPath.c_str());
+	}
+#endif
+}
+
+std::string CompileServer::GetDefaultSocketPath() {
+#ifndef _WIN32
+	return "/tmp/csc-" + std::to_string(::getuid()) + ".sock";
+#else
+	return "";
+#endif
+}
+
+int CompileServer::Run() {
+#ifdef _WIN32
+	std::cerr << "Server mode is not supported on this platform" << std::endl;
+	return 1;
+#else
+	sockaddr_un address;
+	if (!MakeAddress(m_SocketPath, address))
+		return 1;
+
+	// A client that disconnects early must not take the server down
+	std::signal(SIGPIPE, SIG_IGN);
+
+	m_ListenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_ListenFd < 0) {
+		std::cerr << "Failed to create socket" << std::endl;
+		return 1;
+	}
+
+	::unlink(m_SocketPath.c_str());
+	if (::bind(m_ListenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(m_ListenFd, 64) != 0) {
+		std::cerr << "Failed to listen on " << m_SocketPath << std::endl;
+		return 1;
+	}
+	std::cout << "Listening on " << m_SocketPath << std::endl;
+
+	bool running = true;
+	while (running) {
+		int fd = ::accept(m_ListenFd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "Failed to accept connection" << std::endl;
+			return 1;
+		}
+		running = HandleConnection(fd);
+		::close(fd);
+	}
+	return 0;
+#endif
+}
+
+bool CompileServer::HandleConnection(int fd) {
+#ifndef _WIN32
+	std::string header;
+	if (!ReceiveLine(fd, header))
+		return true;
+
+	if (header == "STOP") {
+		SendAll(fd, "0\n", 2);
+		return false;
+	}
+
+	// <command> <format> ...
+	size_t commandEnd = header.find(' ');
+	size_t formatEnd = commandEnd == std::string::npos ? std::string::npos : header.find(' ', commandEnd + 1);
+	AstFormat format;
+	if (formatEnd == std::string::npos || !AstEmitter::ParseFormat(header.substr(commandEnd + 1, formatEnd - commandEnd - 1), format)) {
+		SendError(fd, "Malformed request");
+		return true;
+	}
+
+	std::string command = header.substr(0, commandEnd);
+	std::string argument = header.substr(formatEnd + 1);
+	CachedUnit* cached = nullptr;
+	bool writeBytecode = false;
+
+	if (command == "COMPILE") {
+		cached = GetFileUnit(argument);
+		writeBytecode = true;
+	} else if (command == "SOURCE") {
+		// SOURCE <format> <length> <name>, the length comes from the client and
+		// is checked before anything is allocated for it
+		const char* lengthStart = argument.c_str();
+		char* lengthEnd = nullptr;
+		errno = 0;
+		unsigned long long length = std::strtoull(lengthStart, &lengthEnd, 10);
+		if (lengthEnd == lengthStart || *lengthEnd != ' ' || errno == ERANGE || *lengthStart == '-') {
+			SendError(fd, "Malformed request");
+			return true;
+		}
+		if (length >= UINT32_MAX) {
+			SendError(fd, "Sources of 4 GiB or more are not supported");
+			return true;
+		}
+
+		std::string source;
+		try {
+			source.resize((size_t)length);
+		} catch (const std::bad_alloc&) {
+			SendError(fd, "Not enough memory for a source of " + std::to_string(length) + " bytes");
+			return true;
+		}
+		if (!ReceiveAll(fd, &source[0], source.size()))
+			return true;
+		cached = GetSourceUnit(lengthEnd + 1, std::move(source));
+	} else {
+		SendError(fd, "Unknown command: " + command);
+		return true;
+	}
+
+	if (cached == nullptr) {
+		SendError(fd, "Failed to open file: " + argument);
+		return true;
+	}
+
+	CompileUnit& unit = *cached->Unit;
+	if (writeBytecode && !cached->BytecodeWritten)
+		cached->BytecodeWritten = unit.WriteBytecode() && unit.WriteInterface();
+
+	std::string status = std::to_string((int)unit.GetResult().Type) + "\n";
+	if (!SendAll(fd, status.data(), status.size()))
+		return true;
+	OutputBuffer output(fd);
+	unit.WriteReport(output, format);
+#endif
+	return true;
+}
+
+CompileServer::CachedUnit* CompileServer::GetFileUnit(const std::string& path) {
+#ifndef _WIN32
+	struct stat info;
+	if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+		return nullptr;
+
+#ifdef __APPLE__
+	int64_t modifiedTime = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+	int64_t modifiedTime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+	CachedUnit& cached = m_Files[path];
+	if (cached.Unit != nullptr && cached.ModifiedTime == modifiedTime && cached.Size == (int64_t)info.st_size)
+		return &cached;
+
+	// A file that can't be read has nothing left to cache
+	std::string source;
+	if (!File::ReadTextFile(path, source)) {
+		m_Files.erase(path);
+		return nullptr;
+	}
+	if (cached.Unit == nullptr || cached.Unit->GetSource() != source) {
+		cached.Unit.reset(new CompileUnit(path, std::move(source)));
+		cached.Unit->Analyze({}, &m_SemanticCache);
+		cached.BytecodeWritten = false;
+	}
+	cached.ModifiedTime = modifiedTime;
+	cached.Size = (int64_t)info.st_size;
+	return &cached;
+#else
+	return nullptr;
+#endif
+}
+
+CompileServer::CachedUnit* CompileServer::GetSourceUnit(const std::string& name, std::string source) {
+	CachedUnit& cached = m_Buffers[name];
+	if (cached.Unit == nullptr || cached.Unit->GetSource() != source) {
+		cached.Unit.reset(new CompileUnit(name, std::move(source)));
+		cached.Unit->Analyze({}, &m_SemanticCache);
+	}
+	return &cached;
+}
+
+CompileClient::CompileClient(std::string socketPath) : m_SocketPath(std::move(socketPath)) {
+
+}
+
+bool CompileClient::Compile(const std::string& path, AstFormat format, ResultType& result) {
+#ifndef _WIN32
+	std::string header;
+	std::string body;
+	if (path == "-") {
+		body.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+		header = std::string("SOURCE ") + AstEmitter::FormatToString(format) + " " + std::to_string(body.size()) + " <stdin>";
+	} else {
+		char absolute[PATH_MAX];
+		if (::realpath(path.c_str(), absolute) == nullptr) {
+			std::cerr << "Failed to open file: " << path << std::endl;
+			result = ResultType::Failure;
+			return true;
+		}
+		header = std::string("COMPILE ") + AstEmitter::FormatToString(format) + " " + absolute;
+	}
+
+	if (!SendRequest(header, body))
+		return false;
+	bool received = ReadResponse(result);
+	::close(m_Fd);
+	m_Fd = -1;
+	return received;
+#else
+	return false;
+#endif
+}
+
+bool CompileClient::Stop() {
+#ifndef _WIN32
+	if (!SendRequest("STOP", ""))
+		return false;
+	ResultType result;
+	bool received = ReadResponse(result);
+	::close(m_Fd);
+	m_Fd = -1;
+	return received;
+#else
+	return false;
+#endif
+}
+
+bool CompileClient::SendRequest(const std::string& header, const std::string& body) {
+#ifndef _WIN32
+	sockaddr_un address;
+	if (!MakeAddress(m_SocketPath, address))
+		return false;
+
+	m_Fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_Fd < 0)
+		return false;
+	if (::connect(m_Fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		::close(m_Fd);
+		m_Fd = -1;
+		return false;
+	}
+
+	std::string request = header + "\n" + body;
+	return SendAll(m_Fd, request.data(), request.size());
+#else
+	return false;
+#endif
+}
+
+bool CompileClient::ReadResponse(ResultType& result) {
+#ifndef _WIN32
+	std::string status;
+	if (!ReceiveLine(m_Fd, status))
+		return false;
+	result = (ResultType)std::atoi(status.c_str());
+
+	OutputBuffer output(1);
+	char buffer[1 << 16];
+	while (true) {
+		ssize_t received = ::recv(m_Fd, buffer, sizeof(buffer), 0);
+		if (received < 0 && errno == EINTR)
+			continue;
+		if (received <= 0)
+			break;
+		output.Write(buffer, (size_t)received);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Driver/CompileUnit.h"
+
+// Long running compiler process listening on a Unix domain socket. Parsed
+// units are kept between requests and reused as long as the file on disk
+// (or the submitted buffer) is unchanged.
+//
+// Requests are a single header line, answered with "<ResultType>\n" followed
+// by the same report csc would print:
+//   COMPILE <format> <absolute path>
+//   SOURCE <format> <length> <name>, followed by <length> bytes of source
+//   STOP
+class CompileServer {
+public:
+	explicit CompileServer(std::string socketPath);
+	~CompileServer();
+
+	int Run();
+
+	static std::string GetDefaultSocketPath();
+private:
+	struct CachedUnit {
+		int64_t ModifiedTime = 0;
+		int64_t Size = 0;
+		bool BytecodeWritten = false;
+		std::unique_ptr<CompileUnit> Unit;
+	};
+
+	bool HandleConnection(int fd);
+	CachedUnit* GetFileUnit(const std::string& path);
+	CachedUnit* GetSourceUnit(const std::string& name, std::string source);
+
+	std::string m_SocketPath;
+	int m_ListenFd = -1;
+	std::unordered_map<std::string, CachedUnit> m_Files;
+	std::unordered_map<std::string, CachedUnit> m_Buffers;
+	SemanticCache m_SemanticCache; // Shared by all units, edits usually touch few functions
+};
+
+// Forwards a csc invocation to a running CompileServer
+class CompileClient {
+public:
+	explicit CompileClient(std::string socketPath);
+
+	// Returns false if no server could be reached, the report is copied to stdout
+	bool Compile(const std::string& path, AstFormat format, ResultType& result);
+	bool Stop();
+private:
+	bool SendRequest(const std::string& header, const std::string& body);
+	bool ReadResponse(ResultType& result);
+
+	std::string m_SocketPath;
+	int m_Fd = -1;
+};
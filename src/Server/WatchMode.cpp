@@ -0,0 +1,218 @@
+#include <chrono>
+#include <iostream>
+#include "WatchMode.h"
+#include "IO/File.h"
+
+#ifdef __linux__
+	#include <cerrno>
+	#include <dirent.h>
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+static bool IsSourceFile(const std::string& name) {
+	return name.size() > 4 && name.compare(name.size() - 4, 4, ".csl") == 0;
+}
+
+WatchMode::WatchMode(std::vector<std::string> directories, int debounceMilliseconds)
+	: m_Directories(std::move(directories)), m_DebounceMilliseconds(debounceMilliseconds) {
+
+}
+
+WatchMode::~WatchMode() {
+#ifdef __linux__
+	if (m_Fd >= 0)
+		::close(m_Fd);
+#endif
+}
+
+int WatchMode::Run() {
+#ifndef __linux__
+	std::cerr << "Watch mode is not supported on this platform" << std::endl;
+	return 1;
+#else
+	m_Fd = ::inotify_init1(IN_CLOEXEC);
+	if (m_Fd < 0) {
+		std::cerr << "Failed to initialize inotify" << std::endl;
+		return 1;
+	}
+
+	std::set<std::pair<uint64_t, uint64_t>> visited;
+	for (const std::string& directory : m_Directories)
+		AddDirectory(directory, visited);
+	if (m_WatchedDirectories.empty())
+		return 1;
+
+	// Initial build, everything found while adding the watches is pending
+	for (const std::string& path : m_Pending)
+		Rebuild(path);
+	m_Pending.clear();
+	std::cout << "Watching " << m_WatchedDirectories.size() << " director" << (m_WatchedDirectories.size() == 1 ? "y" : "ies")
+		<< ", " << m_Units.size() << " file(s)" << std::endl;
+
+	pollfd descriptor = {m_Fd, POLLIN, 0};
+	while (true) {
+		// Block until something happens, then keep collecting until it is quiet
+		int ready = ::poll(&descriptor, 1, m_Pending.empty() ? -1 : m_DebounceMilliseconds);
+		if (ready < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "Failed to wait for file changes" << std::endl;
+			return 1;
+		}
+
+		if (ready > 0) {
+			HandleEvents();
+			continue;
+		}
+
+		for (const std::string& path : m_Pending)
+			Rebuild(path);
+		m_Pending.clear();
+	}
+#endif
+}
+
+void WatchMode::AddDirectory(const std::string& directory, std::set<std::pair<uint64_t, uint64_t>>& visited) {
+#ifdef __linux__
+	struct stat directoryInfo;
+	if (::stat(directory.c_str(), &directoryInfo) != 0 || !visited.insert({directoryInfo.st_dev, directoryInfo.st_ino}).second)
+		return;
+
+	uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+	int watch = ::inotify_add_watch(m_Fd, directory.c_str(), mask);
+	if (watch < 0) {
+		std::cerr << "Failed to watch directory: " << directory << std::endl;
+		return;
+	}
+	m_WatchedDirectories[watch] = directory;
+
+	DIR* dir = ::opendir(directory.c_str());
+	if (dir == nullptr)
+		return;
+	while (dirent* entry = ::readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name == "." || name == "..")
+			continue;
+
+		// Symbolic links are not followed, a link to a parent would add the same
+		// directories over and over
+		std::string path = directory + "/" + name;
+		struct stat info;
+		if (::lstat(path.c_str(), &info) != 0)
+			continue;
+		if (S_ISDIR(info.st_mode))
+			AddDirectory(path, visited);
+		else if (S_ISREG(info.st_mode) && IsSourceFile(name))
+			m_Pending.insert(path);
+	}
+	::closedir(dir);
+#endif
+}
+
+void WatchMode::Rescan() {
+	// Adding a watch again keeps its descriptor, only new directories get one
+	std::set<std::pair<uint64_t, uint64_t>> visited;
+	for (const std::string& directory : m_Directories)
+		AddDirectory(directory, visited);
+	// Files deleted while events were lost are only noticed when rebuilding them
+	for (const auto& unit : m_Units)
+		m_Pending.insert(unit.first);
+}
+
+void WatchMode::HandleEvents() {
+#ifdef __linux__
+	alignas(inotify_event) char buffer[1 << 16];
+	ssize_t length = ::read(m_Fd, buffer, sizeof(buffer));
+	if (length <= 0)
+		return;
+
+	for (char* pos = buffer; pos < buffer + length;) {
+		auto* event = reinterpret_cast<inotify_event*>(pos);
+		pos += sizeof(inotify_event) + event->len;
+
+		// Events were dropped, nothing short of looking at everything again is
+		// reliable
+		if (event->mask & IN_Q_OVERFLOW) {
+			std::cout << "Too many changes at once, rescanning" << std::endl;
+			Rescan();
+			continue;
+		}
+
+		auto directory = m_WatchedDirectories.find(event->wd);
+		if (directory == m_WatchedDirectories.end())
+			continue;
+
+		if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+			m_WatchedDirectories.erase(directory);
+			continue;
+		}
+		if (event->len == 0)
+			continue;
+
+		std::string name = event->name;
+		std::string path = directory->second + "/" + name;
+
+		if (event->mask & IN_ISDIR) {
+			if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+				std::set<std::pair<uint64_t, uint64_t>> visited;
+				AddDirectory(path, visited);
+			}
+			continue;
+		}
+		if (!IsSourceFile(name))
+			continue;
+
+		// Rebuild finds out whether the file is still there. IN_CREATE alone is
+		// followed by IN_CLOSE_WRITE once the file is written.
+		if (event->mask & (IN_DELETE | IN_MOVED_FROM | IN_CLOSE_WRITE | IN_MOVED_TO))
+			m_Pending.insert(path);
+	}
+#endif
+}
+
+void WatchMode::Rebuild(const std::string& path) {
+	auto start = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+	// Deleted or moved away before the debounce ran out
+	struct stat info;
+	if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+		auto unit = m_Units.find(path);
+		if (unit != m_Units.end()) {
+			unit->second->RemoveOutputs();
+			m_Units.erase(unit);
+			std::cout << path << ": removed" << std::endl;
+		}
+		return;
+	}
+#endif
+
+	std::string source;
+	if (!File::ReadTextFile(path, source)) {
+		std::cout << path << ": failed to read, skipped" << std::endl;
+		return;
+	}
+	std::unique_ptr<CompileUnit>& unit = m_Units[path];
+	// Saving without changes keeps the previous result
+	if (unit != nullptr && unit->GetSource() == source)
+		return;
+
+	unit.reset(new CompileUnit(path, std::move(source)));
+	unit->Analyze({}, &m_SemanticCache);
+	unit->WriteBytecode();
+	unit->WriteInterface();
+
+	auto end = std::chrono::steady_clock::now();
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	OutputBuffer output;
+	output.Write(path);
+	output.Write(unit->GetResult().Type == ResultType::Success ? ": ok" : ": failed");
+	output.Write(" (");
+	output.WriteUInt((uint64_t)(milliseconds * 1000));
+	output.Write(" us)\n");
+	unit->WriteDiagnostics(output);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Driver/CompileUnit.h"
+
+// Watches directories with inotify and recompiles .csl files as they change.
+// Bursts of events are collected until the directories have been quiet for
+// the debounce interval, then only the touched files are rebuilt.
+class WatchMode {
+public:
+	explicit WatchMode(std::vector<std::string> directories, int debounceMilliseconds = 50);
+	~WatchMode();
+
+	int Run();
+private:
+	// Directories are identified by device and inode, so bind mounts or hard
+	// linked directories that lead back up the tree are only visited once
+	void AddDirectory(const std::string& directory, std::set<std::pair<uint64_t, uint64_t>>& visited);
+	void Rescan();
+	void HandleEvents();
+	void Rebuild(const std::string& path);
+
+	std::vector<std::string> m_Directories;
+	int m_DebounceMilliseconds;
+	int m_Fd = -1;
+	std::unordered_map<int, std::string> m_WatchedDirectories;
+	std::unordered_map<std::string, std::unique_ptr<CompileUnit>> m_Units;
+	std::set<std::string> m_Pending;
+	SemanticCache m_SemanticCache;
+};
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+#include "StringInterner.h"
+
+static constexpr uint32_t s_InitialCapacity = 64;
+
+StringInterner::Table::Table(uint32_t capacity) : Mask(capacity - 1), Slots(new std::atomic<uint32_t>[capacity]) {
+	for (uint32_t i = 0; i < capacity; i++)
+		Slots[i].store(0, std::memory_order_relaxed);
+}
+
+StringInterner::StringInterner(unsigned shardCount) {
+	while ((1u << m_ShardBits) < shardCount && m_ShardBits < 16)
+		m_ShardBits++;
+	m_Shards.reset(new Shard[(size_t)1 << m_ShardBits]);
+	for (uint32_t i = 0; i < (1u << m_ShardBits); i++)
+		m_Shards[i].Slots.store(new Table(s_InitialCapacity), std::memory_order_relaxed);
+}
+
+StringInterner::~StringInterner() {
+	for (uint32_t i = 0; i < (1u << m_ShardBits); i++) {
+		Shard& shard = m_Shards[i];
+		delete shard.Slots.load(std::memory_order_relaxed);
+		for (auto& block : shard.Blocks)
+			delete[] block.load(std::memory_order_relaxed);
+	}
+}
+
+uint32_t StringInterner::Intern(const char* data, size_t length) {
+	uint32_t hash = Hash(data, length);
+	Shard& shard = m_Shards[hash & ((1u << m_ShardBits) - 1)];
+
+	// Most strings are already there, find them without locking
+	uint32_t index = FindIndex(shard, *shard.Slots.load(std::memory_order_acquire), data, length, hash);
+	if (index == s_InvalidId) {
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+		index = Insert(shard, data, length, hash);
+		if (index == s_InvalidId)
+			return s_InvalidId;
+	}
+	return (index << m_ShardBits) | (hash & ((1u << m_ShardBits) - 1));
+}
+
+uint32_t StringInterner::Find(const char* data, size_t length) const {
+	uint32_t hash = Hash(data, length);
+	const Shard& shard = m_Shards[hash & ((1u << m_ShardBits) - 1)];
+	uint32_t index = FindIndex(shard, *shard.Slots.load(std::memory_order_acquire), data, length, hash);
+	return index == s_InvalidId ? s_InvalidId : (index << m_ShardBits) | (hash & ((1u << m_ShardBits) - 1));
+}
+
+std::string StringInterner::Get(uint32_t id) const {
+	const Entry& entry = GetEntry(m_Shards[id & ((1u << m_ShardBits) - 1)], id >> m_ShardBits);
+	return std::string(entry.Data, entry.Length);
+}
+
+size_t StringInterner::GetSize() const {
+	size_t size = 0;
+	for (uint32_t i = 0; i < (1u << m_ShardBits); i++)
+		size += m_Shards[i].Count.load(std::memory_order_acquire);
+	return size;
+}
+
+uint32_t StringInterner::Hash(const char* data, size_t length) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (uint8_t)data[i];
+		hash *= 16777619u;
+	}
+	// The low bits pick the shard, mix the high bits down for the table index
+	return hash ^ (hash >> 15);
+}
+
+void StringInterner::GetBlock(uint32_t index, uint32_t& block, uint32_t& offset) {
+	// Block k starts at (2^k - 1) << s_FirstBlockBits
+	uint32_t scaled = (index >> s_FirstBlockBits) + 1;
+	block = 0;
+	while (scaled >> (block + 1))
+		block++;
+	offset = index - (((1u << block) - 1) << s_FirstBlockBits);
+}
+
+const StringInterner::Entry& StringInterner::GetEntry(const Shard& shard, uint32_t index) const {
+	uint32_t block;
+	uint32_t offset;
+	GetBlock(index, block, offset);
+	return shard.Blocks[block].load(std::memory_order_acquire)[offset];
+}
+
+uint32_t StringInterner::FindIndex(const Shard& shard, const Table& table, const char* data, size_t length,
+	uint32_t hash) const {
+	for (uint32_t i = (hash >> m_ShardBits) & table.Mask;; i = (i + 1) & table.Mask) {
+		uint32_t slot = table.Slots[i].load(std::memory_order_acquire);
+		if (slot == 0)
+			return s_InvalidId;
+
+		const Entry& entry = GetEntry(shard, slot - 1);
+		if (entry.Hash == hash && entry.Length == length && (length == 0 || std::memcmp(entry.Data, data, length) == 0))
+			return slot - 1;
+	}
+}
+
+uint32_t StringInterner::Insert(Shard& shard, const char* data, size_t length, uint32_t hash) {
+	// Another thread may have inserted it or grown the table since the lookup
+	uint32_t index = FindIndex(shard, *shard.Slots.load(std::memory_order_relaxed), data, length, hash);
+	if (index != s_InvalidId)
+		return index;
+
+	index = shard.Count.load(std::memory_order_relaxed);
+	uint32_t maxIndex = std::min<uint64_t>(UINT32_MAX >> m_ShardBits, (((uint64_t)1 << s_BlockCount) - 1) << s_FirstBlockBits);
+	if (index >= maxIndex || length > UINT32_MAX)
+		return s_InvalidId;
+
+	uint32_t block;
+	uint32_t offset;
+	GetBlock(index, block, offset);
+	Entry* entries = shard.Blocks[block].load(std::memory_order_relaxed);
+	if (entries == nullptr) {
+		entries = new Entry[(size_t)1 << (s_FirstBlockBits + block)];
+		shard.Blocks[block].store(entries, std::memory_order_release);
+	}
+	entries[offset] = {Allocate(shard, data, length), (uint32_t)length, hash};
+
+	Table* table = shard.Slots.load(std::memory_order_relaxed);
+	if ((uint64_t)(index + 1) * 2 > (uint64_t)table->Mask + 1) {
+		Grow(shard);
+		table = shard.Slots.load(std::memory_order_relaxed);
+	}
+
+	// The release store publishes the entry to lock free readers
+	uint32_t i = (hash >> m_ShardBits) & table->Mask;
+	while (table->Slots[i].load(std::memory_order_relaxed) != 0)
+		i = (i + 1) & table->Mask;
+	table->Slots[i].store(index + 1, std::memory_order_release);
+	shard.Count.store(index + 1, std::memory_order_release);
+	return index;
+}
+
+const char* StringInterner::Allocate(Shard& shard, const char* data, size_t length) {
+	if (length > shard.ArenaLeft) {
+		size_t size = std::max(length, s_ArenaChunkSize);
+		shard.Arena.emplace_back(new char[size]);
+		shard.ArenaNext = shard.Arena.back().get();
+		shard.ArenaLeft = size;
+	}
+
+	char* copy = shard.ArenaNext;
+	if (length != 0)
+		std::memcpy(copy, data, length);
+	shard.ArenaNext += length;
+	shard.ArenaLeft -= length;
+	return copy;
+}
+
+void StringInterner::Grow(Shard& shard) {
+	Table* old = shard.Slots.load(std::memory_order_relaxed);
+	Table* table = new Table((old->Mask + 1) * 2);
+	uint32_t count = shard.Count.load(std::memory_order_relaxed);
+	for (uint32_t index = 0; index < count; index++) {
+		uint32_t i = (GetEntry(shard, index).Hash >> m_ShardBits) & table->Mask;
+		while (table->Slots[i].load(std::memory_order_relaxed) != 0)
+			i = (i + 1) & table->Mask;
+		table->Slots[i].store(index + 1, std::memory_order_relaxed);
+	}
+
+	// Readers holding the old table either find the string there or retry under
+	// the lock, it stays alive until the interner is destroyed
+	shard.Slots.store(table, std::memory_order_release);
+	shard.Retired.emplace_back(old);
+}
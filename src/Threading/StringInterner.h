@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Maps strings to 32 bit ids from any number of threads at once. Equal strings
+// get the same id no matter which thread interned them first, so ids from
+// different workers can be compared and merged directly.
+//
+// Strings are spread over shards by hash. Lookups never lock: every shard has
+// an open addressing table of entry indices that is only ever replaced as a
+// whole, and entries are published before the slot pointing to them. Inserts
+// of new strings take the mutex of their shard only, which also guards the
+// arena the shard copies its strings into. Ids encode the shard and the index
+// of the entry in it, they stay valid for the lifetime of the interner but
+// depend on the order threads got there first. Output that has to be
+// reproducible renumbers them in a deterministic order, see CodeGenerator.
+class StringInterner {
+public:
+	static constexpr uint32_t s_InvalidId = UINT32_MAX;
+
+	// Rounded up to a power of two, one shard is enough for a single thread
+	explicit StringInterner(unsigned shardCount = 64);
+	~StringInterner();
+
+	StringInterner(const StringInterner&) = delete;
+	StringInterner& operator=(const StringInterner&) = delete;
+
+	uint32_t Intern(const char* data, size_t length);
+	uint32_t Intern(const std::string& string) { return Intern(string.data(), string.size()); }
+	// s_InvalidId if the string was never interned
+	uint32_t Find(const char* data, size_t length) const;
+
+	// The id has to come from this interner
+	std::string Get(uint32_t id) const;
+	size_t GetSize() const;
+private:
+	struct Entry {
+		const char* Data;
+		uint32_t Length;
+		uint32_t Hash;
+	};
+
+	struct Table {
+		explicit Table(uint32_t capacity);
+
+		uint32_t Mask;
+		std::unique_ptr<std::atomic<uint32_t>[]> Slots; // Entry index + 1, 0 if empty
+	};
+
+	// Block k holds 2^(s_FirstBlockBits + k) entries, so entries never move and the
+	// directory stays small
+	static constexpr uint32_t s_FirstBlockBits = 8;
+	static constexpr uint32_t s_BlockCount = 24;
+	static constexpr size_t s_ArenaChunkSize = 64 * 1024;
+
+	struct alignas(64) Shard {
+		std::atomic<Table*> Slots{nullptr};
+		std::atomic<Entry*> Blocks[s_BlockCount] = {};
+		std::atomic<uint32_t> Count{0};
+
+		// Only touched with the mutex held
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<char[]>> Arena;
+		char* ArenaNext = nullptr;
+		size_t ArenaLeft = 0;
+		// Replaced tables, a reader may still be probing one of them
+		std::vector<std::unique_ptr<Table>> Retired;
+	};
+
+	static uint32_t Hash(const char* data, size_t length);
+	static void GetBlock(uint32_t index, uint32_t& block, uint32_t& offset);
+
+	const Entry& GetEntry(const Shard& shard, uint32_t index) const;
+	uint32_t FindIndex(const Shard& shard, const Table& table, const char* data, size_t length, uint32_t hash) const;
+	uint32_t Insert(Shard& shard, const char* data, size_t length, uint32_t hash);
+	const char* Allocate(Shard& shard, const char* data, size_t length);
+	void Grow(Shard& shard);
+
+	std::unique_ptr<Shard[]> m_Shards;
+	uint32_t m_ShardBits = 0;
+};
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+	if (threadCount == 0)
+		threadCount = 1;
+	m_Workers.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_TaskAvailable.notify_all();
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push(std::move(task));
+		m_Pending++;
+	}
+	m_TaskAvailable.notify_one();
+}
+
+void ThreadPool::Wait() {
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_TasksDone.wait(lock, [this] { return m_Pending == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+	if (count == 0)
+		return;
+
+	std::atomic<size_t> next(0);
+	size_t workers = std::min<size_t>(m_Workers.size(), count);
+	for (size_t w = 0; w < workers; w++) {
+		Submit([&next, count, &body] {
+			for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+				body(i);
+		});
+	}
+	Wait();
+}
+
+void ThreadPool::WorkerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_TaskAvailable.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+			if (m_Stopping && m_Tasks.empty())
+				return;
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Pending--;
+			if (m_Pending == 0)
+				m_TasksDone.notify_all();
+		}
+	}
+}
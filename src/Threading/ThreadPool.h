@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> task);
+	void Wait();
+
+	// Runs body(i) for every i in [0, count). Indices are handed out dynamically,
+	// so the order in which they run is unspecified.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	unsigned GetThreadCount() const { return (unsigned)m_Workers.size(); }
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskAvailable;
+	std::condition_variable m_TasksDone;
+	size_t m_Pending = 0;
+	bool m_Stopping = false;
+};
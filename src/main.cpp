@@ -1,38 +1,208 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "IO/File.h"
-#include "Compiler/Parser.h"
-
-void PrintResult(Parser &parser, const CompilerResult &result) {
-	switch (result.Type) {
-		case ResultType::Success:
-			std::cout << "Success" << std::endl;
-			parser.PrintProgramTree();
-			break;
-		case ResultType::InvalidToken:
-			std::cout << "Invalid Token" << std::endl;
-			break;
-		case ResultType::InvalidSyntax:
-			std::cout << "Invalid Syntax" << std::endl;
-			break;
-		case ResultType::Failure:
-			std::cout << "Internal Compiler Error" << std::endl;
-			break;
+#include "Driver/CompileUnit.h"
+#include "Server/CompileServer.h"
+#include "Server/WatchMode.h"
+#include "Runtime/ExecutionEngine.h"
+
+struct RunOptions {
+	bool Run = false;
+	bool Profile = false;
+	uint64_t TierUpThreshold = ExecutionEngine::s_DefaultTierUpThreshold;
+};
+
+static bool RunProgram(const CompileUnit& unit, const RunOptions& options, OutputBuffer& output) {
+	ExecutionEngine engine(unit.GetProgram(), unit.GetSemantics(), options.TierUpThreshold);
+	Value result;
+	bool ok = engine.Run("Main", result);
+
+	if (ok) {
+		output.Write("Main returned ");
+		switch (result.Type) {
+			case ValueType::Int: output.WriteInt(result.Int); break;
+			case ValueType::String: output.Write(result.String); break;
+			default: output.Write("void"); break;
+		}
+		output.Put('\n');
+	} else {
+		output.Write("Runtime Error: ");
+		output.Write(engine.GetError());
+		output.Put('\n');
 	}
+
+	if (options.Profile)
+		engine.WriteProfile(output);
+	return ok;
 }
 
-int main(int argc, char** argv) {
+int CompileFile(const std::string &path, AstFormat format, const RunOptions& options,
+	const std::vector<ModuleInterface*>& imports) {
+	// Nothing is written for a file that couldn't be read, stale outputs must not
+	// look like the result of compiling it
+	std::string code;
+	if (!File::ReadTextFile(path, code))
+		return 1;
+
+	CompileUnit unit(path, std::move(code));
+	unit.Analyze(imports);
+	unit.WriteBytecode();
+	unit.WriteInterface();
+	OutputBuffer output;
+	unit.WriteReport(output, format);
+	output.Flush();
 
-	std::string code = File::ReadTextFile("../example.csl");
+	if (unit.GetResult().Type != ResultType::Success)
+		return 1;
+	if (options.Run && !RunProgram(unit, options, output))
+		return 1;
+	return 0;
+}
+
+// Prints every function as soon as it is parsed and frees it, so the AST of a
+// large file never has to fit in memory
+int StreamFile(const std::string& path, AstFormat format) {
+	if (format == AstFormat::Binary) {
+		std::cerr << "The binary AST format can't be streamed, it needs the function count up front" << std::endl;
+		return 1;
+	}
 
-	Lexer lexer(code);
-    Parser parser(lexer);
-	CompilerResult result = parser.Parse();
+	std::string code;
+	if (!File::ReadTextFile(path, code))
+		return 1;
 
-	PrintResult(parser, result);
+	OutputBuffer output;
+	AstEmitter emitter(output, format);
+	emitter.BeginProgram(0);
+	CompileUnit unit(path, std::move(code), [&](const FunctionNode& function) { emitter.Visit(function); });
+	emitter.EndProgram();
+	unit.WriteDiagnostics(output);
 
-	return 0;
+	return unit.GetResult().Type == ResultType::Success ? 0 : 1;
 }
 
+static void WriteUsage(std::ostream& stream) {
+	stream << "Usage: csc [options] [files...]\n"
+		"  --ast=<format>      AST output format\n"
+		"  --stream            Print functions as they are parsed\n"
+		"  --run               Run Main after compiling\n"
+		"  --profile           Run Main and print a profile\n"
+		"  --tier-up=<calls>   Calls before a function is compiled to bytecode\n"
+		"  --import=<path>     Load a module interface\n"
+		"  --tokens            Trace tokens while lexing\n"
+		"  --watch             Rebuild files in the given directories on change\n"
+		"  --server            Run a compile server\n"
+		"  --client            Compile through a running server\n"
+		"  --stop-server       Stop a running server\n"
+		"  --socket=<path>     Socket of the compile server\n";
+}
 
+int main(int argc, char** argv) {
+	std::vector<std::string> paths;
+	AstFormat format = AstFormat::Text;
+	std::string socketPath = CompileServer::GetDefaultSocketPath();
+	bool server = false;
+	bool client = false;
+	bool stopServer = false;
+	bool watch = false;
+	bool stream = false;
+	RunOptions runOptions;
+	std::vector<std::string> importPaths;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strncmp(argv[i], "--ast=", 6) == 0) {
+			if (!AstEmitter::ParseFormat(argv[i] + 6, format)) {
+				std::cerr << "Unknown AST format: " << argv[i] + 6 << std::endl;
+				return 1;
+			}
+		} else if (std::strncmp(argv[i], "--socket=", 9) == 0) {
+			socketPath = argv[i] + 9;
+		} else if (std::strcmp(argv[i], "--server") == 0) {
+			server = true;
+		} else if (std::strcmp(argv[i], "--client") == 0) {
+			client = true;
+		} else if (std::strcmp(argv[i], "--stop-server") == 0) {
+			stopServer = true;
+		} else if (std::strcmp(argv[i], "--watch") == 0) {
+			watch = true;
+		} else if (std::strncmp(argv[i], "--import=", 9) == 0) {
+			importPaths.push_back(argv[i] + 9);
+		} else if (std::strcmp(argv[i], "--stream") == 0) {
+			stream = true;
+		} else if (std::strcmp(argv[i], "--run") == 0) {
+			runOptions.Run = true;
+		} else if (std::strcmp(argv[i], "--profile") == 0) {
+			runOptions.Run = true;
+			runOptions.Profile = true;
+		} else if (std::strncmp(argv[i], "--tier-up=", 10) == 0) {
+			char* end = nullptr;
+			errno = 0;
+			runOptions.TierUpThreshold = std::strtoull(argv[i] + 10, &end, 10);
+			if (end == argv[i] + 10 || *end != '\0' || errno == ERANGE || argv[i][10] == '-') {
+				std::cerr << "Invalid tier-up threshold: " << argv[i] + 10 << std::endl;
+				return 1;
+			}
+		} else if (std::strcmp(argv[i], "--tokens") == 0) {
+			Lexer::SetTraceTokens(true);
+		} else if (std::strcmp(argv[i], "--help") == 0) {
+			WriteUsage(std::cout);
+			return 0;
+		} else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			// A lone "-" is standard input for the client
+			std::cerr << "Unknown option: " << argv[i] << std::endl;
+			WriteUsage(std::cerr);
+			return 1;
+		} else {
+			paths.push_back(argv[i]);
+		}
+	}
 
+	if (server)
+		return CompileServer(socketPath).Run();
+	if (stopServer)
+		return CompileClient(socketPath).Stop() ? 0 : 1;
+	if (watch)
+		return WatchMode(paths.empty() ? std::vector<std::string>{"."} : paths).Run();
+
+	if (paths.empty())
+		paths.push_back("../example.csl");
+
+	std::vector<std::unique_ptr<ModuleInterface>> modules;
+	std::vector<ModuleInterface*> imports;
+	for (const std::string& importPath : importPaths) {
+		modules.emplace_back(new ModuleInterface());
+		if (!modules.back()->Open(importPath)) {
+			std::cerr << "Failed to load module interface: " << importPath << std::endl;
+			return 1;
+		}
+		imports.push_back(modules.back().get());
+	}
+
+	int status = 0;
+	for (const std::string& path : paths) {
+		if (stream) {
+			if (StreamFile(path, format) != 0)
+				status = 1;
+			continue;
+		}
+
+		// Fall back to compiling in process if no server is running, running and
+		// imports always happen in process
+		ResultType result;
+		if (client && !runOptions.Run && imports.empty() && CompileClient(socketPath).Compile(path, format, result)) {
+			if (result != ResultType::Success)
+				status = 1;
+			continue;
+		}
+		if (CompileFile(path, format, runOptions, imports) != 0)
+			status = 1;
+	}
+
+	return status;
+}
@@ -0,0 +1,33 @@
+# Compiles lib.csl, then app.csl against lib.csi, and checks that the bytecode
+# of app imports the functions of lib instead of failing on them:
+#   cmake -DCSC=<csc> -DSOURCE_DIR=<dir> -DWORK_DIR=<dir> -P ImportCheck.cmake
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(COPY ${SOURCE_DIR}/lib.csl ${SOURCE_DIR}/app.csl DESTINATION ${WORK_DIR})
+
+function(compile expected)
+    execute_process(COMMAND ${CSC} ${ARGN} WORKING_DIRECTORY ${WORK_DIR} RESULT_VARIABLE result
+        OUTPUT_VARIABLE output ERROR_VARIABLE output)
+    if(NOT result EQUAL expected)
+        message(FATAL_ERROR "csc ${ARGN} exited with ${result}, expected ${expected}:\n${output}")
+    endif()
+endfunction()
+
+compile(0 lib.csl)
+# Without the interface the calls can't be resolved
+compile(1 app.csl)
+compile(0 --import=lib.csi app.csl)
+
+file(READ ${WORK_DIR}/app.csb bytecode HEX)
+string(SUBSTRING "${bytecode}" 0 8 magic)
+if(NOT magic STREQUAL "43534232")
+    message(FATAL_ERROR "app.csb does not start with CSB2")
+endif()
+# Import entries are the length of the name and the name, for Add and Greeting
+foreach(entry 03000000416464 080000004772656574696e67)
+    string(FIND "${bytecode}" ${entry} position)
+    if(position EQUAL -1)
+        message(FATAL_ERROR "app.csb has no import entry ${entry}")
+    endif()
+endforeach()